@@ -0,0 +1,307 @@
+/*!
+  \file        avi_writer.h
+  \author      Arnaud Ramey <arnaud.a.ramey@gmail.com>
+                -- Robotics Lab, University Carlos III of Madrid
+  \date        2026/10/18
+
+________________________________________________________________________________
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+________________________________________________________________________________
+
+\class AviWriter writes lossless AVI videos without any external tool:
+each color frame is stored either as a PNG image (FourCC "MPNG",
+the "png" codec of ffmpeg) or as an uncompressed bitmap ("DIB ").
+
+The frames are encoded and written by a background thread,
+fed by a bounded queue: write() only copies the frame,
+so that the caller can compute the next one meanwhile.
+
+The file is an AVI 1.0 (RIFF) file, with an index,
+so it must stay smaller than 4 GB.
+
+ */
+
+#ifndef AVI_WRITER_H
+#define AVI_WRITER_H
+
+#include <stdint.h> // uint32_t
+#include <stdio.h>
+#include <string.h> // memcpy
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/highgui/highgui.hpp> // imencode
+#include "bounded_queue.h"
+
+class AviWriter {
+public:
+  enum Codec {
+    PNG = 0,  //!< each frame is a PNG image
+    RAW       //!< each frame is an uncompressed 24-bit bitmap
+  };
+
+  //! the number of frames waiting to be encoded before write() blocks
+  static const unsigned int QUEUE_SIZE = 8;
+
+  AviWriter() : _file(NULL), _frames(QUEUE_SIZE), _nframes(0), _max_frame_size(0) {}
+
+  ~AviWriter() { close(); }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! create the video \a filename, and start the encoding thread.
+   * \param size  the size of all frames
+   * \return false if the file can not be created
+   */
+  bool open(const std::string & filename,
+            const cv::Size & size,
+            unsigned int fps,
+            Codec codec = PNG) {
+    close();
+    _file = fopen(filename.c_str(), "wb");
+    if (!_file) {
+      printf("AviWriter: could not create file '%s'\n", filename.c_str());
+      return false;
+    }
+    _filename = filename;
+    _size = size;
+    _fps = (fps > 0 ? fps : 1);
+    _codec = codec;
+    _nframes = _max_frame_size = 0;
+    _index.clear();
+    _frames.reopen();
+    write_headers();
+    _encoder = std::thread(&AviWriter::encode_frames, this);
+    return true;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  inline bool is_opened() const { return _file != NULL; }
+
+  //! \return the number of frames given to write() since open()
+  inline unsigned int get_nframes() const { return _nframes; }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! add a frame at the end of the video.
+   * It is copied, then encoded in the background.
+   * \return false if the video is not opened or \a frame has not
+   *    the size given to open()
+   */
+  bool write(const cv::Mat3b & frame) {
+    if (!_file)
+      return false;
+    if (frame.cols != _size.width || frame.rows != _size.height) {
+      printf("AviWriter: frame of size (%ix%i), different from (%ix%i)\n",
+             frame.cols, frame.rows, _size.width, _size.height);
+      return false;
+    }
+    cv::Mat3b copy;
+    frame.copyTo(copy);
+    if (!_frames.push(copy))
+      return false;
+    ++_nframes;
+    return true;
+  }
+
+  //! add a frame, \see write()
+  inline AviWriter & operator << (const cv::Mat3b & frame) {
+    write(frame);
+    return *this;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! wait for the frames to be encoded, then write the index
+   * and the sizes of the headers. Called by the destructor.
+   * \return false if a write failed
+   */
+  bool close() {
+    if (!_file)
+      return true;
+    _frames.close();
+    _encoder.join();
+    // index, with offsets relative to the "movi" FourCC
+    long index_pos = ftell(_file);
+    _chunk.clear();
+    put_fourcc("idx1");
+    put32(16 * _index.size());
+    for (unsigned int frame_idx = 0; frame_idx < _index.size(); ++frame_idx) {
+      put_fourcc(frame_fourcc());
+      put32(0x10); // AVIIF_KEYFRAME
+      put32(_index[frame_idx].offset - (_movi_pos + 8));
+      put32(_index[frame_idx].size);
+    } // end loop frame_idx
+    bool ok = (fwrite(_chunk.data(), 1, _chunk.size(), _file) == _chunk.size());
+    long end_pos = ftell(_file);
+    // sizes that were unknown when writing the headers
+    ok = ok && patch32(4, end_pos - 8); // RIFF size
+    ok = ok && patch32(_avih_pos + 8 + 16, _index.size()); // dwTotalFrames
+    ok = ok && patch32(_avih_pos + 8 + 28, _max_frame_size); // dwSuggestedBufferSize
+    ok = ok && patch32(_strh_pos + 8 + 32, _index.size()); // dwLength
+    ok = ok && patch32(_strh_pos + 8 + 36, _max_frame_size); // dwSuggestedBufferSize
+    ok = ok && patch32(_movi_pos + 4, index_pos - (_movi_pos + 8)); // LIST size
+    ok = (fclose(_file) == 0) && ok && _index.size() == _nframes;
+    _file = NULL;
+    if (!ok)
+      printf("AviWriter: could not write file '%s'\n", _filename.c_str());
+    return ok;
+  }
+
+protected:
+  //! where a frame was written
+  struct IndexEntry {
+    long offset;
+    uint32_t size;
+  };
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  inline void put32(uint32_t value) {
+    for (int byte = 0; byte < 4; ++byte)
+      _chunk.push_back((value >> (8 * byte)) & 0xFF);
+  }
+  inline void put16(uint16_t value) {
+    _chunk.push_back(value & 0xFF);
+    _chunk.push_back(value >> 8);
+  }
+  inline void put_fourcc(const char* fourcc) {
+    _chunk.insert(_chunk.end(), fourcc, fourcc + 4);
+  }
+  inline uint32_t fourcc_value(const char* fourcc) const {
+    return (uchar) fourcc[0] | ((uchar) fourcc[1] << 8)
+        | ((uchar) fourcc[2] << 16) | ((uint32_t) (uchar) fourcc[3] << 24);
+  }
+  inline const char* frame_fourcc() const { return (_codec == PNG ? "00dc" : "00db"); }
+  inline const char* codec_fourcc() const { return (_codec == PNG ? "MPNG" : "DIB "); }
+
+  //! overwrite the 32 bits at \a pos, then go back to the end of the file
+  bool patch32(long pos, uint32_t value) {
+    uchar bytes[4];
+    for (int byte = 0; byte < 4; ++byte)
+      bytes[byte] = (value >> (8 * byte)) & 0xFF;
+    bool ok = (fseek(_file, pos, SEEK_SET) == 0 && fwrite(bytes, 1, 4, _file) == 4);
+    return (fseek(_file, 0, SEEK_END) == 0) && ok;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! write the headers, the sizes and the number of frames being set by close()
+  void write_headers() {
+    uint32_t bitmap_size = ((3 * _size.width + 3) & ~3u) * _size.height;
+    _chunk.clear();
+    put_fourcc("RIFF"); put32(0); put_fourcc("AVI ");
+    put_fourcc("LIST"); put32(4 + 8 + 56 + 8 + 4 + 8 + 56 + 8 + 40); put_fourcc("hdrl");
+    // main header
+    _avih_pos = _chunk.size();
+    put_fourcc("avih"); put32(56);
+    put32(1000000 / _fps); // dwMicroSecPerFrame
+    put32(0); // dwMaxBytesPerSec
+    put32(0); // dwPaddingGranularity
+    put32(0x10); // dwFlags: AVIF_HASINDEX
+    put32(0); // dwTotalFrames
+    put32(0); // dwInitialFrames
+    put32(1); // dwStreams
+    put32(0); // dwSuggestedBufferSize
+    put32(_size.width); put32(_size.height);
+    put32(0); put32(0); put32(0); put32(0); // dwReserved
+    // stream header
+    put_fourcc("LIST"); put32(4 + 8 + 56 + 8 + 40); put_fourcc("strl");
+    _strh_pos = _chunk.size();
+    put_fourcc("strh"); put32(56);
+    put_fourcc("vids"); put_fourcc(codec_fourcc());
+    put32(0); // dwFlags
+    put16(0); put16(0); // wPriority, wLanguage
+    put32(0); // dwInitialFrames
+    put32(1); put32(_fps); // dwScale, dwRate
+    put32(0); // dwStart
+    put32(0); // dwLength
+    put32(0); // dwSuggestedBufferSize
+    put32(0xFFFFFFFF); // dwQuality
+    put32(0); // dwSampleSize
+    put16(0); put16(0); put16(_size.width); put16(_size.height); // rcFrame
+    // stream format: BITMAPINFOHEADER
+    put_fourcc("strf"); put32(40);
+    put32(40);
+    put32(_size.width); put32(_size.height);
+    put16(1); put16(24); // biPlanes, biBitCount
+    put32(_codec == PNG ? fourcc_value("MPNG") : 0); // biCompression: BI_RGB
+    put32(bitmap_size);
+    put32(0); put32(0); put32(0); put32(0);
+    // frames
+    _movi_pos = _chunk.size();
+    put_fourcc("LIST"); put32(0); put_fourcc("movi");
+    fwrite(_chunk.data(), 1, _chunk.size(), _file);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! store \a frame in _frame_data
+  void encode_frame(const cv::Mat3b & frame) {
+    if (_codec == PNG) {
+      cv::imencode(".png", frame, _frame_data);
+      return;
+    }
+    // bitmap: bottom-up rows, each one padded to 4 bytes
+    unsigned int row_size = (3 * frame.cols + 3) & ~3u;
+    _frame_data.assign(row_size * frame.rows, 0);
+    for (int row = 0; row < frame.rows; ++row)
+      memcpy(&_frame_data[row_size * (frame.rows - 1 - row)],
+             frame.ptr(row), 3 * frame.cols);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! the loop of the encoding thread, until close()
+  void encode_frames() {
+    cv::Mat3b frame;
+    while (_frames.pop(frame)) {
+      encode_frame(frame);
+      IndexEntry entry;
+      entry.offset = ftell(_file);
+      entry.size = _frame_data.size();
+      _chunk.clear();
+      put_fourcc(frame_fourcc());
+      put32(entry.size);
+      if (entry.size % 2)
+        _frame_data.push_back(0); // chunks are padded to 2 bytes
+      if (fwrite(_chunk.data(), 1, _chunk.size(), _file) != _chunk.size()
+          || fwrite(_frame_data.data(), 1, _frame_data.size(), _file) != _frame_data.size())
+        continue; // the frame is missing from the index, close() fails
+      _index.push_back(entry);
+      _max_frame_size = std::max(_max_frame_size, entry.size);
+    } // end while (_frames.pop(frame))
+  }
+
+  FILE* _file;
+  std::string _filename;
+  cv::Size _size;
+  unsigned int _fps;
+  Codec _codec;
+  //! the frames waiting to be encoded
+  BoundedQueue<cv::Mat3b> _frames;
+  std::thread _encoder;
+  unsigned int _nframes;
+  // written by the encoding thread, then read by close()
+  std::vector<IndexEntry> _index;
+  uint32_t _max_frame_size;
+  std::vector<uchar> _chunk, _frame_data;
+  //! the positions of the headers in the file
+  long _avih_pos, _strh_pos, _movi_pos;
+}; // end class AviWriter
+
+#endif // AVI_WRITER_H
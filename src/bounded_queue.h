@@ -0,0 +1,102 @@
+/*!
+  \file        bounded_queue.h
+  \author      Arnaud Ramey <arnaud.a.ramey@gmail.com>
+                -- Robotics Lab, University Carlos III of Madrid
+  \date        2026/10/18
+
+________________________________________________________________________________
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+________________________________________________________________________________
+
+A queue of limited capacity between the threads of a pipeline:
+the producers wait while it is full, the consumers while it is empty,
+so that a fast stage can not fill the memory ahead of a slow one.
+Once the producers are done, close() lets the consumers empty it and stop.
+
+ */
+
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+template<class T>
+class BoundedQueue {
+public:
+  //! \param capacity the maximum number of items in the queue, at least 1
+  explicit BoundedQueue(unsigned int capacity)
+    : _capacity(capacity > 0 ? capacity : 1), _closed(false) {}
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! add \a item at the end of the queue, waiting while it is full.
+   * \return false if the queue was closed, \a item being dropped
+   */
+  bool push(T item) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _not_full.wait(lock, [this] { return _closed || _items.size() < _capacity; });
+    if (_closed)
+      return false;
+    _items.push_back(std::move(item));
+    _not_empty.notify_one();
+    return true;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! take the first item of the queue, waiting while it is empty.
+   * \return false if the queue is closed and empty
+   */
+  bool pop(T & item) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _not_empty.wait(lock, [this] { return _closed || !_items.empty(); });
+    if (_items.empty())
+      return false;
+    item = std::move(_items.front());
+    _items.pop_front();
+    _not_full.notify_one();
+    return true;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! no item can be pushed anymore, the ones in the queue can still be popped
+  void close() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _closed = true;
+    _not_empty.notify_all();
+    _not_full.notify_all();
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! empty the queue and make it usable again after close()
+  void reopen() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _items.clear();
+    _closed = false;
+  }
+
+private:
+  unsigned int _capacity;
+  bool _closed;
+  std::deque<T> _items;
+  std::mutex _mutex;
+  std::condition_variable _not_empty, _not_full;
+}; // end class BoundedQueue
+
+#endif // BOUNDED_QUEUE_H
@@ -22,15 +22,31 @@ ________________________________________________________________________________
 
 A class for fast computing image contours and updating them.
 
+Its pixels are a workspace, \see fit_workspace(): they are overwritten
+by the next from_image_*() or from_runs(), and moved when the image grows.
+A copy of an ImageContour has its own workspace,
+but a cv::Mat1b header on it shares its pixels: clone() it to keep them.
+
+The numbers of contour and inner pixels are kept up to date
+by the set_point_empty_*() functions, so that contour_size() and inside_size()
+do not scan the image.
+from_image_C4() and from_image_C8() use the vector contour kernels
+of RowKernels, and can split the rows in bands computed by a ThreadPool.
+
  */
 
 #ifndef IMAGE_CONTOUR_H
 #define IMAGE_CONTOUR_H
 
 #include <stdio.h>
+#include <string.h> // memset
+#include <algorithm>
 #include <vector>
 #include <numeric>      // std::accumulate
 #include <opencv2/core/core.hpp>
+#include "row_kernels.h"
+#include "thread_pool.h"
+#include "workspace.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -42,35 +58,152 @@ public:
     INNER = 128
   };
 
-  ImageContour() : cv::Mat1b(0, 0) {}
+  //! the non-zero pixels [begin, end) of row \a row
+  struct Run {
+    int row, begin, end;
+  };
+
+  ImageContour() : cv::Mat1b(0, 0), _ncontour(0), _ninner(0) {
+    _instructions = RowKernels::best_instructions();
+  }
+
+  //! a copy of the pixels of \a other, on a workspace of its own
+  ImageContour(const ImageContour & other) : cv::Mat1b(0, 0) {
+    *this = other;
+  }
+
+  ImageContour & operator = (const ImageContour & other) {
+    if (this == &other)
+      return *this;
+    fit_workspace(*this, _buffer, other.rows, other.cols);
+    for (int row = 0; row < rows; ++row)
+      memcpy(ptr<uchar>(row), other.ptr<uchar>(row), cols);
+    rowsm = other.rowsm;
+    colsm = other.colsm;
+    _ncontour = other._ncontour;
+    _ninner = other._ninner;
+    _instructions = other._instructions;
+    return *this;
+  }
 
   //////////////////////////////////////////////////////////////////////////////
 
-  //! build frtom the non zero pixels of \arg img, using C4 neigbourhood
-  inline void from_image_C4(const cv::Mat1b & img) {
-    from_image(img, false);
+  /*! set the instructions used by from_image_C4() and from_image_C8().
+   * By default, the most powerful ones supported by the CPU,
+   * which \a instructions can not exceed, \see RowKernels::supported().
+   */
+  inline void set_instructions(RowKernels::Instructions instructions) {
+    _instructions = RowKernels::supported(instructions);
   }
 
   //////////////////////////////////////////////////////////////////////////////
 
-  //! build frtom the non zero pixels of \arg img, using C8 neigbourhood
-  inline void from_image_C8(const cv::Mat1b & img) {
-    from_image(img, true);
+  /*! build frtom the non zero pixels of \arg img, using C4 neigbourhood.
+   * \param pool if not NULL, the bands of rows are computed by its workers */
+  inline void from_image_C4(const cv::Mat1b & img, ThreadPool* pool = NULL) {
+    from_image(img, false, pool);
   }
 
   //////////////////////////////////////////////////////////////////////////////
 
-  //! compute contour size
-  inline unsigned int contour_size() const {
-    return cv::countNonZero(contour_image());
+  /*! build frtom the non zero pixels of \arg img, using C8 neigbourhood.
+   * \param pool if not NULL, the bands of rows are computed by its workers */
+  inline void from_image_C8(const cv::Mat1b & img, ThreadPool* pool = NULL) {
+    from_image(img, true, pool);
   }
 
   //////////////////////////////////////////////////////////////////////////////
 
-  //! compute size of the inner non-zero pixels
-  inline unsigned int inside_size() const {
-    cv::Mat1b this_cp = *this;
-    return cv::countNonZero(this_cp == INNER);
+  /*! build from runs of non zero pixels, without an image.
+   * The states are set from the ends of the runs and from the runs
+   * of the rows above and below: the inside of the runs is only filled.
+   * \param input_runs
+   *    sorted by row then by column, not overlapping,
+   *    all inside \a window. The runs of a row that touch each other
+   *    are merged first, \see maximal_runs().
+   * \param window
+   *    the rectangle of the coordinates of the runs that is built,
+   *    the pixel (0, 0) corresponding to window.tl()
+   * \param C8  true for a C8 neighbourhood, false for C4
+   */
+  inline void from_runs(const std::vector<Run> & input_runs, const cv::Rect & window,
+                        bool C8 = false) {
+    const std::vector<Run> & runs = maximal_runs(input_runs);
+    fit_workspace(*this, _buffer, window.height, window.width);
+    _ncontour = _ninner = 0;
+    if (cols == 0 || rows == 0) {
+      printf("Empty image\n");
+      return;
+    }
+    setTo(EMPTY);
+    colsm = cols - 1;
+    rowsm = rows - 1;
+    // a pixel whose neighbours are in the adjacent row
+    // is covered by a run of this row, eroded by one pixel in C8
+    int shrink = (C8 ? 1 : 0);
+    unsigned int nruns = runs.size(), first = 0;
+    // the runs of the previous row [prev_first, prev_last)
+    unsigned int prev_first = 0, prev_last = 0;
+    while (first < nruns) {
+      int row = runs[first].row;
+      unsigned int last = first, next_last;
+      while (last < nruns && runs[last].row == row)
+        ++last;
+      for (next_last = last; next_last < nruns && runs[next_last].row == row + 1; )
+        ++next_last;
+      if (prev_first == prev_last || runs[prev_first].row != row - 1)
+        prev_first = prev_last = first; // no previous row
+      uchar* row_ptr = ptr<uchar>(row - window.y) - window.x;
+      bool border_row = (row == window.y || row == window.y + rowsm);
+      unsigned int up = prev_first, down = last;
+      for (unsigned int run_idx = first; run_idx < last; ++run_idx) {
+        int begin = runs[run_idx].begin, end = runs[run_idx].end;
+        if (border_row) {
+          memset(row_ptr + begin, CONTOUR, end - begin);
+          _ncontour += end - begin;
+          continue;
+        }
+        memset(row_ptr + begin, INNER, end - begin);
+        row_ptr[begin] = row_ptr[end - 1] = CONTOUR;
+        set_uncovered_contour(row_ptr, begin, end, runs, up, prev_last, shrink);
+        set_uncovered_contour(row_ptr, begin, end, runs, down, next_last, shrink);
+        unsigned int run_ncontour = std::count(row_ptr + begin, row_ptr + end, (uchar) CONTOUR);
+        _ncontour += run_ncontour;
+        _ninner += (end - begin) - run_ncontour;
+      } // end loop run_idx
+      prev_first = first;
+      prev_last = last;
+      first = last;
+    } // end while (first < nruns)
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! \return the number of contour pixels, in constant time
+  inline unsigned int contour_size() const { return _ncontour; }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! \return the number of inner non-zero pixels, in constant time
+  inline unsigned int inside_size() const { return _ninner; }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! count again the contour and inner pixels.
+   * Needed only after writing pixels without set_point_empty_*(),
+   * for instance with operator()
+   */
+  inline void recount() {
+    _ncontour = _ninner = 0;
+    for (int row = 0; row < rows; ++row) {
+      const uchar* row_ptr = ptr<uchar>(row);
+      for (int col = 0; col < cols; ++col) {
+        if (row_ptr[col] == CONTOUR)
+          ++_ncontour;
+        else if (row_ptr[col] == INNER)
+          ++_ninner;
+      } // end loop col
+    } // end loop row
   }
 
   //////////////////////////////////////////////////////////////////////////////
@@ -96,15 +229,33 @@ public:
   //! set a given point (row, col) as empty, with a C4 neighbourhood
   inline void set_point_empty_C4(int row, int col) {
     int key = row * cols + col;
-    data[key] = EMPTY;
-    if (col && data[key - 1] == INNER) // left
-      data[key - 1] = CONTOUR;
-    if (col < colsm && data[key + 1] == INNER) // right
-      data[key + 1] = CONTOUR;
-    if (row && data[key - cols] == INNER) // up
-      data[key - cols] = CONTOUR;
-    if (row < rowsm && data[key + cols] == INNER) // down
-      data[key + cols] = CONTOUR;
+    set_empty(key);
+    if (col) // left
+      set_contour_if_inner(key - 1);
+    if (col < colsm) // right
+      set_contour_if_inner(key + 1);
+    if (row) // up
+      set_contour_if_inner(key - cols);
+    if (row < rowsm) // down
+      set_contour_if_inner(key + cols);
+  } // end set_point_empty();
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! set a given point (row, col) as empty, with a C4 neighbourhood,
+   * and push the keys (row * cols + col) of the inner pixels
+   * that become contour pixels to \a frontier */
+  inline void set_point_empty_C4(int row, int col, std::vector<int> & frontier) {
+    int key = row * cols + col;
+    set_empty(key);
+    if (col && set_contour_if_inner(key - 1)) // left
+      frontier.push_back(key - 1);
+    if (col < colsm && set_contour_if_inner(key + 1)) // right
+      frontier.push_back(key + 1);
+    if (row && set_contour_if_inner(key - cols)) // up
+      frontier.push_back(key - cols);
+    if (row < rowsm && set_contour_if_inner(key + cols)) // down
+      frontier.push_back(key + cols);
   } // end set_point_empty();
 
   //////////////////////////////////////////////////////////////////////////////
@@ -112,30 +263,42 @@ public:
   //! set a given point (row, col) as empty, with a C8 neighbourhood
   inline void set_point_empty_C8(int row, int col) {
     int key = row * cols + col;
-    data[key] = EMPTY;
+    set_empty(key);
     bool left_ok = col, right_ok = col < colsm,
         up_ok = row, down_ok = row < rowsm;
-    if (left_ok && up_ok && data[key - 1] == INNER) // left
-      data[key - 1] = CONTOUR;
-    if (right_ok && data[key + 1] == INNER) // right
-      data[key + 1] = CONTOUR;
-    if (up_ok && data[key - cols] == INNER) // up
-      data[key - cols] = CONTOUR;
-    if (down_ok && data[key + cols] == INNER) // down
-      data[key + cols] = CONTOUR;
+    if (left_ok && up_ok) // left
+      set_contour_if_inner(key - 1);
+    if (right_ok) // right
+      set_contour_if_inner(key + 1);
+    if (up_ok) // up
+      set_contour_if_inner(key - cols);
+    if (down_ok) // down
+      set_contour_if_inner(key + cols);
 
     // C8
-    if (left_ok && up_ok && data[key - 1 - cols] == INNER) // left - up
-      data[key - 1 - cols] = CONTOUR;
-    if (right_ok && up_ok && data[key + 1 - cols] == INNER) // right - up
-      data[key + 1 - cols] = CONTOUR;
-    if (left_ok && down_ok && data[key - 1 + cols] == INNER) // left - down
-      data[key - 1 + cols] = CONTOUR;
-    if (right_ok && down_ok && data[key + 1 + cols] == INNER) // right - down
-      data[key + 1 + cols] = CONTOUR;
+    if (left_ok && up_ok) // left - up
+      set_contour_if_inner(key - 1 - cols);
+    if (right_ok && up_ok) // right - up
+      set_contour_if_inner(key + 1 - cols);
+    if (left_ok && down_ok) // left - down
+      set_contour_if_inner(key - 1 + cols);
+    if (right_ok && down_ok) // right - down
+      set_contour_if_inner(key + 1 + cols);
   } // end set_point_empty();
 
 
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! store in \a keys the keys (row * cols + col) of all contour pixels
+  inline void contour_keys(std::vector<int> & keys) const {
+    keys.clear();
+    int npixels = cols * rows;
+    for (int key = 0; key < npixels; ++key) {
+      if (data[key] == CONTOUR)
+        keys.push_back(key);
+    } // end loop key
+  }
+
   //////////////////////////////////////////////////////////////////////////////
 
   //! \return a compact string representation of a given ImageContour-linke image
@@ -201,92 +364,139 @@ public:
 private:
   ////////////////////////////////////////////////////////////////////////////////
 
-  inline void from_image(const cv::Mat1b & img, bool C8 = false) {
+  inline void from_image(const cv::Mat1b & img, bool C8, ThreadPool* pool) {
     // printf("from_image(cols:%i, rows:%i)\n", img.cols, img.rows);
-    create(img.rows, img.cols) ;
-    if (cols * rows == 0) {
+    fit_workspace(*this, _buffer, img.rows, img.cols);
+    _ncontour = _ninner = 0;
+    if (cols == 0 || rows == 0) {
       printf("Empty image\n");
       return;
     }
-    assert(img.isContinuous());
-    assert(isContinuous());
-    setTo(EMPTY);
     colsm = cols - 1;
     rowsm = rows - 1;
-    const uchar *img_data = img.data, *img_ptr = img.data;
-    uchar* out_ptr = ptr<uchar>(0);
-    if (C8)
-      from_image_loop_C8(img_data, img_ptr, out_ptr);
+    int nbands = (pool ? std::max(1, std::min(pool->size(), rows / MIN_BAND_ROWS)) : 1);
+    _band_ncontour.assign(nbands, 0);
+    _band_ninner.assign(nbands, 0);
+    if (nbands == 1)
+      from_image_band(img, C8, 0, 1);
     else
-      from_image_loop_C4(img_data, img_ptr, out_ptr);
+      pool->parallel_for(nbands, [&](int band, int) {
+        from_image_band(img, C8, band, nbands);
+      });
+    for (int band = 0; band < nbands; ++band) {
+      _ncontour += _band_ncontour[band];
+      _ninner += _band_ninner[band];
+    } // end loop band
   }
 
   ////////////////////////////////////////////////////////////////////////////////
 
-  inline void from_image_loop_C4(const uchar* img_data, const uchar* img_ptr,
-                                 uchar* out_ptr) {
-    for (int row = 0; row < rows; ++row) {
-      for (int col = 0; col < cols; ++col) {
-        //printf("row:%i, col:%i\n", row, col);
-        if (*img_ptr) {
-          int key = row * cols + col;
-          if ((!col || col == colsm || !row || row == rowsm) // border
-              || (col            && *img_ptr != img_data[key - 1]) //left
-              || (col < colsm    && *img_ptr != img_data[key + 1]) // right
-              || (row            && *img_ptr != img_data[key - cols]) // up
-              || (row < rowsm    && *img_ptr != img_data[key + cols])) // down
-          { // contour
-            // printf("row:%i, col:%i is contour!\n", row, col);
-            *out_ptr = CONTOUR;
-            //out_ptr[key] = CONTOUR;
-          } // end if real contour
-          else // inner point
-            *out_ptr = INNER;
-          //out_ptr[key] = INNER;
-        } // end if (img_ptr)
-        img_ptr++;
-        out_ptr++;
-      } // end loop col
+  //! the rows of the band \a band among \a nbands of from_image()
+  inline void from_image_band(const cv::Mat1b & img, bool C8, int band, int nbands) {
+    RowKernels::ContourRowFn row_fn = RowKernels::contour(_instructions);
+    int begin = rows * band / nbands, end = rows * (band + 1) / nbands;
+    unsigned int & ncontour = _band_ncontour[band], & ninner = _band_ninner[band];
+    for (int row = begin; row < end; ++row) {
+      const uchar* img_ptr = img.ptr<uchar>(row);
+      uchar* out_ptr = ptr<uchar>(row);
+      if (row == 0 || row == rowsm) { // border
+        for (int col = 0; col < cols; ++col) {
+          out_ptr[col] = (img_ptr[col] ? CONTOUR : EMPTY);
+          ncontour += (img_ptr[col] != 0);
+        } // end loop col
+        continue;
+      }
+      row_fn(img.ptr<uchar>(row - 1), img_ptr, img.ptr<uchar>(row + 1), out_ptr,
+             cols, C8, CONTOUR, INNER, ncontour, ninner);
     } // end loop row
-  } // end from_image_loop_C4()
+  }
 
   ////////////////////////////////////////////////////////////////////////////////
 
-  inline void from_image_loop_C8(const uchar* img_data, const uchar* img_ptr,
-                                 uchar* out_ptr) {
-    for (int row = 0; row < rows; ++row) {
-      for (int col = 0; col < cols; ++col) {
-        //printf("row:%i, col:%i\n", row, col);
-        if (*img_ptr) {
-          int key = row * cols + col;
-          bool left_ok = col, right_ok = col < colsm,
-              up_ok = row, down_ok = row < rowsm;
-          if ((!left_ok || !right_ok || !up_ok || !down_ok) // border
-              || (left_ok              && *img_ptr != img_data[key - 1]) // L
-              || (right_ok             && *img_ptr != img_data[key + 1]) // R
-              || (up_ok                && *img_ptr != img_data[key - cols]) // U
-              || (down_ok              && *img_ptr != img_data[key + cols]) // D
-              || (left_ok && up_ok     && *img_ptr != img_data[key - cols - 1]) // LU
-              || (left_ok && down_ok   && *img_ptr != img_data[key + cols - 1]) // LD
-              || (right_ok && up_ok    && *img_ptr != img_data[key - cols + 1]) // RU
-              || (right_ok && down_ok  && *img_ptr != img_data[key + cols + 1]) // RD
-              )
-          { // contour
-            // printf("row:%i, col:%i is contour!\n", row, col);
-            *out_ptr = CONTOUR;
-          } // end if real contour
-          else // inner point
-            *out_ptr = INNER;
-        } // end if (img_ptr)
-        img_ptr++;
-        out_ptr++;
-      } // end loop col
-    } // end loop row
-  } // end from_image_loop_C8()
+  //! set the pixel \a key (row * cols + col) to EMPTY
+  inline void set_empty(int key) {
+    if (data[key] == CONTOUR)
+      --_ncontour;
+    else if (data[key] == INNER)
+      --_ninner;
+    data[key] = EMPTY;
+  }
+
+  //! set the pixel \a key to CONTOUR if it is INNER, \return true if it was
+  inline bool set_contour_if_inner(int key) {
+    if (data[key] != INNER)
+      return false;
+    data[key] = CONTOUR;
+    --_ninner;
+    ++_ncontour;
+    return true;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! \return \a runs where the runs of a row that touch each other are merged:
+   * otherwise their ends inside the shapes would be CONTOUR.
+   * \a runs itself if there are none, without copying it.
+   */
+  const std::vector<Run> & maximal_runs(const std::vector<Run> & runs) {
+    unsigned int run_idx = 1;
+    while (run_idx < runs.size() && (runs[run_idx].row != runs[run_idx - 1].row
+                                     || runs[run_idx].begin > runs[run_idx - 1].end))
+      ++run_idx;
+    if (run_idx >= runs.size())
+      return runs;
+    _maximal_runs.assign(runs.begin(), runs.begin() + run_idx);
+    for (; run_idx < runs.size(); ++run_idx) {
+      Run & last = _maximal_runs.back();
+      if (runs[run_idx].row == last.row && runs[run_idx].begin <= last.end)
+        last.end = std::max(last.end, runs[run_idx].end);
+      else
+        _maximal_runs.push_back(runs[run_idx]);
+    } // end loop run_idx
+    return _maximal_runs;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! set as CONTOUR the pixels of the run [\a begin, \a end) of \a row_ptr
+   * that are not covered by the runs [\a adj, \a adj_last) of an adjacent row,
+   * these ones being eroded by \a shrink pixels.
+   * \a adj is moved to the first run that can cover the next runs of the row.
+   */
+  static inline void set_uncovered_contour(uchar* row_ptr, int begin, int end,
+                                           const std::vector<Run> & runs,
+                                           unsigned int & adj, unsigned int adj_last,
+                                           int shrink) {
+    while (adj < adj_last && runs[adj].end - shrink <= begin)
+      ++adj;
+    int col = begin; // the first pixel not checked yet
+    for (unsigned int adj_idx = adj; adj_idx < adj_last && col < end; ++adj_idx) {
+      int cover_begin = runs[adj_idx].begin + shrink,
+          cover_end = runs[adj_idx].end - shrink;
+      if (cover_begin >= end)
+        break;
+      if (cover_begin > col)
+        memset(row_ptr + col, CONTOUR, cover_begin - col);
+      col = std::max(col, cover_end);
+    } // end loop adj_idx
+    if (col < end)
+      memset(row_ptr + col, CONTOUR, end - col);
+  }
 
   //////////////////////////////////////////////////////////////////////////////
 
+  //! the minimum number of rows of the bands of from_image()
+  static const int MIN_BAND_ROWS = 16;
   int rowsm, colsm;
+  //! the numbers of CONTOUR and INNER pixels
+  unsigned int _ncontour, _ninner;
+  RowKernels::Instructions _instructions;
+  //! the numbers of CONTOUR and INNER pixels of each band of from_image()
+  std::vector<unsigned int> _band_ncontour, _band_ninner;
+  //! the memory of the image, that only grows
+  std::vector<uchar> _buffer;
+  //! the merged runs of from_runs(), \see maximal_runs()
+  std::vector<Run> _maximal_runs;
   cv::Mat3b _illus;
 }; // end class Imagecontour
 
@@ -0,0 +1,734 @@
+/*!
+  \file        row_kernels.h
+  \author      Arnaud Ramey <arnaud.a.ramey@gmail.com>
+                -- Robotics Lab, University Carlos III of Madrid
+  \date        2026/10/18
+
+________________________________________________________________________________
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+________________________________________________________________________________
+
+Row kernels for one sub-iteration of the raster Zhang-Suen and Guo-Hall
+thinnings: a scalar one, based on the table of the algorithm,
+and SSE2, AVX2 and AVX-512BW ones that evaluate 16, 32 or 64 pixels per step.
+The best kernel supported by the CPU is chosen at runtime.
+
+The contour kernels build the states of ImageContour in the same way,
+and the threshold kernels find the bounding box of the shapes
+and binarize them, skipping the zero pixels a vector at a time.
+The morphological kernels erode a row and add the residue of its
+dilation to the skeleton, for the morphological thinning.
+
+ */
+
+#ifndef ROW_KERNELS_H
+#define ROW_KERNELS_H
+
+#include <stdint.h> // uint64_t
+#include <algorithm>
+#include <string.h> // memcpy
+#include <opencv2/core/core.hpp>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ROW_KERNELS_X86
+#endif
+
+class RowKernels {
+public:
+  enum Instructions {
+    SCALAR = 0,
+    SSE2 = 1,
+    AVX2 = 2,
+    AVX512BW = 3
+  };
+
+  /*! A row kernel sets to 0 in \a out the pixels of row \a mid that need it,
+   * for the columns [1, cols - 2]. \a up and \a down are the rows above and
+   * below \a mid. \a out must be a copy of \a mid, all values being 0 or 1.
+   * \a table is the table of the algorithm for sub-iteration \a iter.
+   * \return true if a pixel was set to 0
+   */
+  typedef bool (*RowFn)(const uchar* up, const uchar* mid, const uchar* down,
+                        uchar* out, int cols, int iter, const uchar* table);
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! \return the most powerful set of instructions supported by the CPU
+  static inline Instructions best_instructions() {
+#ifdef ROW_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512bw"))
+      return AVX512BW;
+    if (__builtin_cpu_supports("avx2"))
+      return AVX2;
+    if (__builtin_cpu_supports("sse2"))
+      return SSE2;
+#endif // ROW_KERNELS_X86
+    return SCALAR;
+  }
+
+  /*! \return \a instructions if the CPU supports them,
+   * otherwise the most powerful ones it supports */
+  static inline Instructions supported(Instructions instructions) {
+    return std::min(instructions, best_instructions());
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! \return the name of a set of instructions
+  static inline const char* instructions_name(Instructions instructions) {
+    switch (instructions) {
+      case SSE2:
+        return "sse2";
+      case AVX2:
+        return "avx2";
+      case AVX512BW:
+        return "avx512bw";
+      case SCALAR:
+      default:
+        return "scalar";
+    } // end switch (instructions)
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! \return the Zhang-Suen kernel for a given set of instructions
+  static inline RowFn zhang_suen(Instructions instructions) {
+#ifdef ROW_KERNELS_X86
+    switch (instructions) {
+      case AVX512BW:
+        return zhang_suen_avx512bw;
+      case AVX2:
+        return zhang_suen_avx2;
+      case SSE2:
+        return zhang_suen_sse2;
+      default:
+        break;
+    } // end switch (instructions)
+#endif // ROW_KERNELS_X86
+    (void) instructions;
+    return scalar;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! \return the Guo-Hall kernel for a given set of instructions
+  static inline RowFn guo_hall(Instructions instructions) {
+#ifdef ROW_KERNELS_X86
+    switch (instructions) {
+      case AVX512BW:
+        return guo_hall_avx512bw;
+      case AVX2:
+        return guo_hall_avx2;
+      case SSE2:
+        return guo_hall_sse2;
+      default:
+        break;
+    } // end switch (instructions)
+#endif // ROW_KERNELS_X86
+    (void) instructions;
+    return scalar;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! A contour kernel writes in \a out the state of each pixel of the row
+   * \a mid of a mask, \a up and \a down being the rows above and below:
+   * 0 for the zero pixels, \a contour for the non-zero pixels of the first
+   * and last columns and the ones with a 4-neighbour (8-neighbour if \a C8)
+   * of another value, \a inner for the other ones.
+   * The numbers of contour and inner pixels are added to \a ncontour and \a ninner.
+   */
+  typedef void (*ContourRowFn)(const uchar* up, const uchar* mid, const uchar* down,
+                               uchar* out, int cols, bool C8, uchar contour, uchar inner,
+                               unsigned int & ncontour, unsigned int & ninner);
+
+  //! \return the contour kernel for a given set of instructions
+  static inline ContourRowFn contour(Instructions instructions) {
+#ifdef ROW_KERNELS_X86
+    switch (instructions) {
+      case AVX512BW:
+        return contour_avx512bw;
+      case AVX2:
+        return contour_avx2;
+      case SSE2:
+        return contour_sse2;
+      default:
+        break;
+    } // end switch (instructions)
+#endif // ROW_KERNELS_X86
+    (void) instructions;
+    return contour_scalar;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! A scan kernel \return the first column (or the last one) of [\a begin, \a end)
+   * where \a row is > \a thresh, \a end (or \a begin - 1) if there is none.
+   */
+  typedef int (*ScanFn)(const uchar* row, int begin, int end, uchar thresh);
+
+  /*! A threshold kernel writes in \a out the \a cols pixels of \a in
+   * that are > \a thresh, the other ones being 0.
+   * With \a binarize, the ones > \a thresh are set to 1.
+   */
+  typedef void (*ThresholdRowFn)(const uchar* in, uchar* out, int cols,
+                                 uchar thresh, bool binarize);
+
+  //! \return the kernel finding the first column > thresh, for a given set of instructions
+  static inline ScanFn first_above(Instructions instructions) {
+#ifdef ROW_KERNELS_X86
+    switch (instructions) {
+      case AVX512BW:
+        return first_above_avx512bw;
+      case AVX2:
+        return first_above_avx2;
+      case SSE2:
+        return first_above_sse2;
+      default:
+        break;
+    } // end switch (instructions)
+#endif // ROW_KERNELS_X86
+    (void) instructions;
+    return first_above_scalar;
+  }
+
+  //! \return the kernel finding the last column > thresh, for a given set of instructions
+  static inline ScanFn last_above(Instructions instructions) {
+#ifdef ROW_KERNELS_X86
+    switch (instructions) {
+      case AVX512BW:
+        return last_above_avx512bw;
+      case AVX2:
+        return last_above_avx2;
+      case SSE2:
+        return last_above_sse2;
+      default:
+        break;
+    } // end switch (instructions)
+#endif // ROW_KERNELS_X86
+    (void) instructions;
+    return last_above_scalar;
+  }
+
+  //! \return the threshold kernel for a given set of instructions
+  static inline ThresholdRowFn threshold(Instructions instructions) {
+#ifdef ROW_KERNELS_X86
+    switch (instructions) {
+      case AVX512BW:
+        return threshold_avx512bw;
+      case AVX2:
+        return threshold_avx2;
+      case SSE2:
+        return threshold_sse2;
+      default:
+        break;
+    } // end switch (instructions)
+#endif // ROW_KERNELS_X86
+    (void) instructions;
+    return threshold_scalar;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! A morphological erosion kernel writes in \a out the erosion of the row
+   * \a mid of a mask of 0 and 1 by a 3x3 cross, \a up and \a down being
+   * the rows above and below, for the columns [\a begin, \a end),
+   * 1 <= \a begin and \a end <= cols - 1.
+   * \return true if a pixel of \a out is non-zero
+   */
+  typedef bool (*MorphErodeRowFn)(const uchar* up, const uchar* mid, const uchar* down,
+                                  uchar* out, int begin, int end);
+
+  /*! A morphological residue kernel adds to \a out the pixels of \a in
+   * that are not in the dilation by a 3x3 cross of the row \a mid of an
+   * eroded mask of 0 and 1, \a up and \a down being the rows above and below,
+   * for the columns [\a begin, \a end), 1 <= \a begin and \a end <= cols - 1.
+   */
+  typedef void (*MorphResidueRowFn)(const uchar* in, const uchar* up, const uchar* mid,
+                                    const uchar* down, uchar* out, int begin, int end);
+
+  //! \return the erosion kernel for a given set of instructions
+  static inline MorphErodeRowFn morph_erode(Instructions instructions) {
+#ifdef ROW_KERNELS_X86
+    switch (instructions) {
+      case AVX512BW:
+        return morph_erode_avx512bw;
+      case AVX2:
+        return morph_erode_avx2;
+      case SSE2:
+        return morph_erode_sse2;
+      default:
+        break;
+    } // end switch (instructions)
+#endif // ROW_KERNELS_X86
+    (void) instructions;
+    return morph_erode_scalar;
+  }
+
+  //! \return the residue kernel for a given set of instructions
+  static inline MorphResidueRowFn morph_residue(Instructions instructions) {
+#ifdef ROW_KERNELS_X86
+    switch (instructions) {
+      case AVX512BW:
+        return morph_residue_avx512bw;
+      case AVX2:
+        return morph_residue_avx2;
+      case SSE2:
+        return morph_residue_sse2;
+      default:
+        break;
+    } // end switch (instructions)
+#endif // ROW_KERNELS_X86
+    (void) instructions;
+    return morph_residue_scalar;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! The 3x3 neighbourhood of a pixel p1 is encoded in a 9-bit index,
+   * column by column, so that it can be updated incrementally
+   * when moving along a row:
+   *
+   *   bit   0  3  6        p9 p2 p3
+   *         1  4  7   <=>  p8 p1 p4
+   *         2  5  8        p7 p6 p5
+   */
+  static inline int column_bits(const uchar* up, const uchar* mid,
+                                const uchar* down, int col) {
+    return (up[col] != 0) | ((mid[col] != 0) << 1) | ((down[col] != 0) << 2);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! the reference kernel, for the columns [first_col, cols - 2]
+  static inline bool scalar_from(const uchar* up, const uchar* mid, const uchar* down,
+                                 uchar* out, int cols, const uchar* table,
+                                 int first_col) {
+    bool haschanged = false;
+    int colmax = cols - 1;
+    if (first_col >= colmax)
+      return false;
+    // columns first_col - 1 and first_col, column first_col + 1 is added in the first loop
+    int idx = (column_bits(up, mid, down, first_col - 1) << 3)
+        | (column_bits(up, mid, down, first_col) << 6);
+    for (int col = first_col; col < colmax; col++) {
+      idx = (idx >> 3) | (column_bits(up, mid, down, col + 1) << 6);
+      if (table[idx]) {
+        out[col] = 0;
+        haschanged = true;
+      }
+    } // end loop col
+    return haschanged;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  static bool scalar(const uchar* up, const uchar* mid, const uchar* down,
+                     uchar* out, int cols, int /*iter*/, const uchar* table) {
+    return scalar_from(up, mid, down, out, cols, table, 1);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! the reference contour kernel, for the columns [first_col, cols - 2]
+  static inline void contour_scalar_from(const uchar* up, const uchar* mid, const uchar* down,
+                                         uchar* out, int cols, bool C8,
+                                         uchar contour, uchar inner,
+                                         unsigned int & ncontour, unsigned int & ninner,
+                                         int first_col) {
+    for (int col = first_col; col < cols - 1; ++col) {
+      uchar m = mid[col];
+      if (!m) {
+        out[col] = 0;
+        continue;
+      }
+      bool diff = (mid[col - 1] != m || mid[col + 1] != m
+                   || up[col] != m || down[col] != m);
+      if (C8)
+        diff = diff || (up[col - 1] != m || up[col + 1] != m
+                        || down[col - 1] != m || down[col + 1] != m);
+      out[col] = (diff ? contour : inner);
+      ++(diff ? ncontour : ninner);
+    } // end loop col
+  }
+
+  //! the first and last columns of a contour kernel
+  static inline void contour_ends(const uchar* mid, uchar* out, int cols, uchar contour,
+                                  unsigned int & ncontour) {
+    for (int col = 0; col < cols; col += std::max(cols - 1, 1)) {
+      out[col] = (mid[col] ? contour : 0);
+      ncontour += (mid[col] != 0);
+    } // end loop col
+  }
+
+  static void contour_scalar(const uchar* up, const uchar* mid, const uchar* down,
+                             uchar* out, int cols, bool C8, uchar contour, uchar inner,
+                             unsigned int & ncontour, unsigned int & ninner) {
+    contour_ends(mid, out, cols, contour, ncontour);
+    contour_scalar_from(up, mid, down, out, cols, C8, contour, inner,
+                        ncontour, ninner, 1);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  static int first_above_scalar(const uchar* row, int begin, int end, uchar thresh) {
+    while (begin < end && row[begin] <= thresh)
+      ++begin;
+    return begin;
+  }
+
+  static int last_above_scalar(const uchar* row, int begin, int end, uchar thresh) {
+    while (end > begin && row[end - 1] <= thresh)
+      --end;
+    return end - 1;
+  }
+
+  //! the reference threshold kernel, for the columns [first_col, cols)
+  static inline void threshold_scalar_from(const uchar* in, uchar* out, int cols,
+                                           uchar thresh, bool binarize, int first_col) {
+    if (binarize) {
+      for (int col = first_col; col < cols; ++col)
+        out[col] = (in[col] > thresh);
+    }
+    else {
+      for (int col = first_col; col < cols; ++col)
+        out[col] = (in[col] > thresh ? in[col] : 0);
+    }
+  }
+
+  static void threshold_scalar(const uchar* in, uchar* out, int cols,
+                               uchar thresh, bool binarize) {
+    threshold_scalar_from(in, out, cols, thresh, binarize, 0);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  static bool morph_erode_scalar(const uchar* up, const uchar* mid, const uchar* down,
+                                 uchar* out, int begin, int end) {
+    uchar nonzero = 0;
+    for (int col = begin; col < end; ++col) {
+      out[col] = mid[col] & up[col] & down[col] & mid[col - 1] & mid[col + 1];
+      nonzero |= out[col];
+    } // end loop col
+    return nonzero;
+  }
+
+  static void morph_residue_scalar(const uchar* in, const uchar* up, const uchar* mid,
+                                   const uchar* down, uchar* out, int begin, int end) {
+    for (int col = begin; col < end; ++col)
+      out[col] |= in[col] & ~(mid[col] | up[col] | down[col] | mid[col - 1] | mid[col + 1]);
+  }
+
+#ifdef ROW_KERNELS_X86
+protected:
+  //////////////////////////////////////////////////////////////////////////////
+
+  typedef uchar V16 __attribute__((vector_size(16)));
+  typedef uchar V32 __attribute__((vector_size(32)));
+  typedef uchar V64 __attribute__((vector_size(64)));
+
+  // vectors are only passed by reference, as the helpers are compiled
+  // without the instructions of the kernels they are inlined in
+
+  /*! Zhang-Suen rule on vectors of pixels equal to 0 or 1,
+   * \a p[1] to \a p[9] being the neighbourhood.
+   * Sets \a del to 0xFF where true, 0 elsewhere */
+  struct ZhangSuenRule {
+    template<class V>
+    static inline __attribute__((always_inline))
+    void need_set(const V* p, int iter, V & del) {
+      V A  = (p[3] & ~p[2]) + (p[4] & ~p[3]) + (p[5] & ~p[4]) + (p[6] & ~p[5])
+          + (p[7] & ~p[6]) + (p[8] & ~p[7]) + (p[9] & ~p[8]) + (p[2] & ~p[9]);
+      V B  = p[2] + p[3] + p[4] + p[5] + p[6] + p[7] + p[8] + p[9];
+      V m  = (iter == 0 ? ((p[2] & p[4] & p[6]) | (p[4] & p[6] & p[8]))
+                        : ((p[2] & p[4] & p[8]) | (p[2] & p[6] & p[8])));
+      // each comparison is cast before being combined, otherwise GCC
+      // scalarizes the combination of the AVX-512 masks
+      del = (V) (p[1] != 0) & (V) (A == 1) & (V) (B >= 2) & (V) (B <= 6)
+          & (V) (m == 0);
+    }
+  }; // end struct ZhangSuenRule
+
+  /*! Guo-Hall rule on vectors of pixels equal to 0 or 1,
+   * \a p[1] to \a p[9] being the neighbourhood.
+   * Sets \a del to 0xFF where true, 0 elsewhere */
+  struct GuoHallRule {
+    template<class V>
+    static inline __attribute__((always_inline))
+    void need_set(const V* p, int iter, V & del) {
+      V C  = ((p[3] | p[4]) & ~p[2]) + ((p[5] | p[6]) & ~p[4])
+          + ((p[7] | p[8]) & ~p[6]) + ((p[9] | p[2]) & ~p[8]);
+      V N1 = (p[9] | p[2]) + (p[3] | p[4]) + (p[5] | p[6]) + (p[7] | p[8]);
+      V N2 = (p[2] | p[3]) + (p[4] | p[5]) + (p[6] | p[7]) + (p[8] | p[9]);
+      V m  = (iter == 0 ? ((p[6] | p[7] | (p[9] ^ 1)) & p[8])
+                        : ((p[2] | p[3] | (p[5] ^ 1)) & p[4]));
+      // 2 <= min(N1, N2) <= 3
+      del = (V) (p[1] != 0) & (V) (C == 1) & (V) (N1 >= 2) & (V) (N2 >= 2)
+          & ((V) (N1 <= 3) | (V) (N2 <= 3)) & (V) (m == 0);
+    }
+  }; // end struct GuoHallRule
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! the vector kernel, the columns that do not fill a vector use the table
+  template<class V, class Rule>
+  static inline __attribute__((always_inline))
+  bool vector_row(const uchar* up, const uchar* mid, const uchar* down,
+                  uchar* out, int cols, int iter, const uchar* table) {
+    const int size = sizeof(V);
+    V p[10], del, out_vec, changed = {};
+    int col = 1;
+    for (; col + size <= cols - 1; col += size) {
+      memcpy(&p[1], mid + col, size);
+      memcpy(&p[2], up + col, size);
+      memcpy(&p[3], up + col + 1, size);
+      memcpy(&p[4], mid + col + 1, size);
+      memcpy(&p[5], down + col + 1, size);
+      memcpy(&p[6], down + col, size);
+      memcpy(&p[7], down + col - 1, size);
+      memcpy(&p[8], mid + col - 1, size);
+      memcpy(&p[9], up + col - 1, size);
+      Rule::need_set(p, iter, del);
+      memcpy(&out_vec, out + col, size);
+      out_vec &= ~del;
+      memcpy(out + col, &out_vec, size);
+      changed |= del;
+    } // end loop col
+    uint64_t changed_words[size / 8];
+    memcpy(changed_words, &changed, size);
+    bool haschanged = false;
+    for (int i = 0; i < size / 8; ++i)
+      haschanged = haschanged || changed_words[i];
+    if (scalar_from(up, mid, down, out, cols, table, col))
+      haschanged = true;
+    return haschanged;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! the vector contour kernel, the columns that do not fill a vector are scalar
+  template<class V>
+  static inline __attribute__((always_inline))
+  void vector_contour_row(const uchar* up, const uchar* mid, const uchar* down,
+                          uchar* out, int cols, bool C8, uchar contour, uchar inner,
+                          unsigned int & ncontour, unsigned int & ninner) {
+    const int size = sizeof(V);
+    V zero = {}, contour_vec = zero + contour, inner_vec = zero + inner;
+    contour_ends(mid, out, cols, contour, ncontour);
+    int col = 1;
+    while (col + size <= cols - 1) {
+      // the counters are bytes, summed before they overflow
+      V ncontour_vec = {}, ninner_vec = {};
+      for (int nvecs = 0; nvecs < 255 && col + size <= cols - 1; ++nvecs, col += size) {
+        V m, n, diff = {};
+        memcpy(&m, mid + col, size);
+        memcpy(&n, mid + col - 1, size);   diff |= (V) (n != m);
+        memcpy(&n, mid + col + 1, size);   diff |= (V) (n != m);
+        memcpy(&n, up + col, size);        diff |= (V) (n != m);
+        memcpy(&n, down + col, size);      diff |= (V) (n != m);
+        if (C8) {
+          memcpy(&n, up + col - 1, size);    diff |= (V) (n != m);
+          memcpy(&n, up + col + 1, size);    diff |= (V) (n != m);
+          memcpy(&n, down + col - 1, size);  diff |= (V) (n != m);
+          memcpy(&n, down + col + 1, size);  diff |= (V) (n != m);
+        }
+        V nonzero = (V) (m != zero);
+        V is_contour = nonzero & diff, is_inner = nonzero & ~diff;
+        V out_vec = (is_contour & contour_vec) | (is_inner & inner_vec);
+        memcpy(out + col, &out_vec, size);
+        // the lanes of the masks are 0xFF, i.e. -1
+        ncontour_vec -= is_contour;
+        ninner_vec -= is_inner;
+      } // end loop nvecs
+      uchar lanes[2][size];
+      memcpy(lanes[0], &ncontour_vec, size);
+      memcpy(lanes[1], &ninner_vec, size);
+      for (int lane = 0; lane < size; ++lane) {
+        ncontour += lanes[0][lane];
+        ninner += lanes[1][lane];
+      } // end loop lane
+    } // end while (col + size <= cols - 1)
+    contour_scalar_from(up, mid, down, out, cols, C8, contour, inner,
+                        ncontour, ninner, col);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! \return true if a lane of the mask \a mask is set
+  template<class V>
+  static inline __attribute__((always_inline))
+  bool any_lane(const V & mask) {
+    uint64_t words[sizeof(V) / 8];
+    memcpy(words, &mask, sizeof(V));
+    uint64_t any = 0;
+    for (unsigned int i = 0; i < sizeof(V) / 8; ++i)
+      any |= words[i];
+    return any;
+  }
+
+  //! the vector scan kernels: whole vectors of pixels <= thresh are skipped
+  template<class V>
+  static inline __attribute__((always_inline))
+  int vector_first_above(const uchar* row, int begin, int end, uchar thresh) {
+    const int size = sizeof(V);
+    V thresh_vec = V() + thresh, vec;
+    for (; begin + size <= end; begin += size) {
+      memcpy(&vec, row + begin, size);
+      if (any_lane<V>((V) (vec > thresh_vec)))
+        break;
+    } // end loop begin
+    return first_above_scalar(row, begin, end, thresh);
+  }
+
+  template<class V>
+  static inline __attribute__((always_inline))
+  int vector_last_above(const uchar* row, int begin, int end, uchar thresh) {
+    const int size = sizeof(V);
+    V thresh_vec = V() + thresh, vec;
+    for (; end - size >= begin; end -= size) {
+      memcpy(&vec, row + end - size, size);
+      if (any_lane<V>((V) (vec > thresh_vec)))
+        break;
+    } // end loop end
+    return last_above_scalar(row, begin, end, thresh);
+  }
+
+  //! the vector threshold kernel, the columns that do not fill a vector are scalar
+  template<class V>
+  static inline __attribute__((always_inline))
+  void vector_threshold_row(const uchar* in, uchar* out, int cols,
+                            uchar thresh, bool binarize) {
+    const int size = sizeof(V);
+    V thresh_vec = V() + thresh, ones = V() + 1, vec;
+    int col = 0;
+    for (; col + size <= cols; col += size) {
+      memcpy(&vec, in + col, size);
+      V above = (V) (vec > thresh_vec);
+      vec = (binarize ? (above & ones) : (above & vec));
+      memcpy(out + col, &vec, size);
+    } // end loop col
+    threshold_scalar_from(in, out, cols, thresh, binarize, col);
+  }
+
+  //! the vector morphological kernels, the columns that do not fill a vector are scalar
+  template<class V>
+  static inline __attribute__((always_inline))
+  bool vector_morph_erode_row(const uchar* up, const uchar* mid, const uchar* down,
+                              uchar* out, int begin, int end) {
+    const int size = sizeof(V);
+    V vec, n, nonzero = {};
+    int col = begin;
+    for (; col + size <= end; col += size) {
+      memcpy(&vec, mid + col, size);
+      memcpy(&n, up + col, size);        vec &= n;
+      memcpy(&n, down + col, size);      vec &= n;
+      memcpy(&n, mid + col - 1, size);   vec &= n;
+      memcpy(&n, mid + col + 1, size);   vec &= n;
+      memcpy(out + col, &vec, size);
+      nonzero |= vec;
+    } // end loop col
+    bool nonzero_end = morph_erode_scalar(up, mid, down, out, col, end);
+    return (nonzero_end || any_lane<V>(nonzero));
+  }
+
+  template<class V>
+  static inline __attribute__((always_inline))
+  void vector_morph_residue_row(const uchar* in, const uchar* up, const uchar* mid,
+                                const uchar* down, uchar* out, int begin, int end) {
+    const int size = sizeof(V);
+    V vec, n, dilated;
+    int col = begin;
+    for (; col + size <= end; col += size) {
+      memcpy(&dilated, mid + col, size);
+      memcpy(&n, up + col, size);        dilated |= n;
+      memcpy(&n, down + col, size);      dilated |= n;
+      memcpy(&n, mid + col - 1, size);   dilated |= n;
+      memcpy(&n, mid + col + 1, size);   dilated |= n;
+      memcpy(&vec, in + col, size);
+      memcpy(&n, out + col, size);
+      n |= vec & ~dilated;
+      memcpy(out + col, &n, size);
+    } // end loop col
+    morph_residue_scalar(in, up, mid, down, out, col, end);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+#define ROW_KERNELS_DEFINE(name, isa, V, Rule) \
+  __attribute__((target(isa))) \
+  static bool name(const uchar* up, const uchar* mid, const uchar* down, \
+                   uchar* out, int cols, int iter, const uchar* table) { \
+    return vector_row<V, Rule>(up, mid, down, out, cols, iter, table); \
+  }
+  ROW_KERNELS_DEFINE(zhang_suen_sse2,     "sse2",     V16, ZhangSuenRule)
+  ROW_KERNELS_DEFINE(zhang_suen_avx2,     "avx2",     V32, ZhangSuenRule)
+  ROW_KERNELS_DEFINE(zhang_suen_avx512bw, "avx512bw", V64, ZhangSuenRule)
+  ROW_KERNELS_DEFINE(guo_hall_sse2,       "sse2",     V16, GuoHallRule)
+  ROW_KERNELS_DEFINE(guo_hall_avx2,       "avx2",     V32, GuoHallRule)
+  ROW_KERNELS_DEFINE(guo_hall_avx512bw,   "avx512bw", V64, GuoHallRule)
+#undef ROW_KERNELS_DEFINE
+
+#define CONTOUR_KERNELS_DEFINE(name, isa, V) \
+  __attribute__((target(isa))) \
+  static void name(const uchar* up, const uchar* mid, const uchar* down, \
+                   uchar* out, int cols, bool C8, uchar contour, uchar inner, \
+                   unsigned int & ncontour, unsigned int & ninner) { \
+    vector_contour_row<V>(up, mid, down, out, cols, C8, contour, inner, \
+                          ncontour, ninner); \
+  }
+  CONTOUR_KERNELS_DEFINE(contour_sse2,     "sse2",     V16)
+  CONTOUR_KERNELS_DEFINE(contour_avx2,     "avx2",     V32)
+  CONTOUR_KERNELS_DEFINE(contour_avx512bw, "avx512bw", V64)
+#undef CONTOUR_KERNELS_DEFINE
+
+#define THRESHOLD_KERNELS_DEFINE(suffix, isa, V) \
+  __attribute__((target(isa))) \
+  static int first_above_##suffix(const uchar* row, int begin, int end, uchar thresh) { \
+    return vector_first_above<V>(row, begin, end, thresh); \
+  } \
+  __attribute__((target(isa))) \
+  static int last_above_##suffix(const uchar* row, int begin, int end, uchar thresh) { \
+    return vector_last_above<V>(row, begin, end, thresh); \
+  } \
+  __attribute__((target(isa))) \
+  static void threshold_##suffix(const uchar* in, uchar* out, int cols, \
+                                 uchar thresh, bool binarize) { \
+    vector_threshold_row<V>(in, out, cols, thresh, binarize); \
+  }
+  THRESHOLD_KERNELS_DEFINE(sse2,     "sse2",     V16)
+  THRESHOLD_KERNELS_DEFINE(avx2,     "avx2",     V32)
+  THRESHOLD_KERNELS_DEFINE(avx512bw, "avx512bw", V64)
+#undef THRESHOLD_KERNELS_DEFINE
+
+#define MORPH_KERNELS_DEFINE(suffix, isa, V) \
+  __attribute__((target(isa))) \
+  static bool morph_erode_##suffix(const uchar* up, const uchar* mid, const uchar* down, \
+                                   uchar* out, int begin, int end) { \
+    return vector_morph_erode_row<V>(up, mid, down, out, begin, end); \
+  } \
+  __attribute__((target(isa))) \
+  static void morph_residue_##suffix(const uchar* in, const uchar* up, const uchar* mid, \
+                                     const uchar* down, uchar* out, int begin, int end) { \
+    vector_morph_residue_row<V>(in, up, mid, down, out, begin, end); \
+  }
+  MORPH_KERNELS_DEFINE(sse2,     "sse2",     V16)
+  MORPH_KERNELS_DEFINE(avx2,     "avx2",     V32)
+  MORPH_KERNELS_DEFINE(avx512bw, "avx512bw", V64)
+#undef MORPH_KERNELS_DEFINE
+#endif // ROW_KERNELS_X86
+}; // end class RowKernels
+
+#endif // ROW_KERNELS_H
@@ -0,0 +1,199 @@
+/*!
+  \file        sparse_skeleton.h
+  \author      Arnaud Ramey <arnaud.a.ramey@gmail.com>
+                -- Robotics Lab, University Carlos III of Madrid
+  \date        2026/10/18
+
+________________________________________________________________________________
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+________________________________________________________________________________
+
+\struct SparseSkeleton holds the pixels of a skeleton without the image:
+as a list of points, as horizontal runs of pixels, or as 8-connected
+chain codes. The coordinates are the ones of the full image.
+
+The points and runs are added row by row with add_row(),
+while the skeleton is written.
+The chains are then traced by build_chains() from the points:
+each pixel of the skeleton belongs to exactly one chain.
+The chains start preferably at the ends of the branches.
+
+The vectors are cleared but never shrunk, so that a SparseSkeleton
+that is reused does not allocate memory anymore.
+
+ */
+
+#ifndef SPARSE_SKELETON_H
+#define SPARSE_SKELETON_H
+
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include "image_contour.h"
+
+struct SparseSkeleton {
+  //! the outputs to compute, to combine with |
+  enum Output {
+    NONE = 0,
+    POINTS = 1,
+    RUNS = 2,
+    CHAINS = 4
+  };
+
+  //! the pixels [begin, end) of row \a row
+  typedef ImageContour::Run Run;
+
+  /*! a chain of pixels: \a start, then the moves chain_codes[first_code]
+   * ... chain_codes[first_code + ncodes - 1], \see move()
+   */
+  struct Chain {
+    cv::Point start;
+    int first_code, ncodes;
+  };
+
+  //! the outputs to compute, a combination of Output
+  int outputs;
+  //! the pixels of the skeleton, row by row
+  std::vector<cv::Point> points;
+  std::vector<Run> runs;
+  std::vector<Chain> chains;
+  //! the Freeman codes of all chains: 0 = +x, then counter-clockwise, 2 = -y
+  std::vector<uchar> chain_codes;
+
+  SparseSkeleton() : outputs(NONE) {}
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! \return the move of the Freeman code \a code, between 0 and 7
+  static inline cv::Point move(int code) {
+    static const int dx[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+    static const int dy[8] = {0, -1, -1, -1, 0, 1, 1, 1};
+    return cv::Point(dx[code], dy[code]);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! remove the pixels, keeping the memory
+  inline void clear() {
+    points.clear();
+    runs.clear();
+    chains.clear();
+    chain_codes.clear();
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! add the non zero pixels of a row of a skeleton.
+   * \param row_ptr  the \a cols pixels of the row
+   * \param offset   the coordinates of row_ptr[0] in the full image
+   */
+  inline void add_row(const uchar* row_ptr, int cols, const cv::Point & offset) {
+    // the chains are traced from the points
+    bool add_points = (outputs & (POINTS | CHAINS)), add_runs = (outputs & RUNS);
+    int col = 0;
+    while (true) {
+      while (col < cols && !row_ptr[col])
+        ++col;
+      if (col == cols)
+        break;
+      int begin = col;
+      while (col < cols && row_ptr[col])
+        ++col;
+      if (add_runs) {
+        Run run;
+        run.row = offset.y;
+        run.begin = offset.x + begin;
+        run.end = offset.x + col;
+        runs.push_back(run);
+      }
+      if (add_points) {
+        for (int x = begin; x < col; ++x)
+          points.push_back(cv::Point(offset.x + x, offset.y));
+      }
+    } // end while (true)
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! trace the chains of the points.
+   * \param skel
+   *    the skeleton the points come from, its non zero pixels being 255.
+   *    They are marked during the tracing, then set back to 255.
+   * \param offset  the coordinates of the first pixel of \a skel in the full image
+   */
+  void build_chains(cv::Mat1b & skel, const cv::Point & offset) {
+    chains.clear();
+    chain_codes.clear();
+    // first from the ends of the branches, then from any pixel (loops)
+    for (int pass = 0; pass < 2; ++pass) {
+      for (unsigned int pt_idx = 0; pt_idx < points.size(); ++pt_idx) {
+        cv::Point pt = points[pt_idx] - offset;
+        if (skel(pt) != 255 || (pass == 0 && nneighbours(skel, pt) != 1))
+          continue;
+        trace_chain(skel, pt, offset);
+      } // end loop pt_idx
+    } // end loop pass
+    for (unsigned int pt_idx = 0; pt_idx < points.size(); ++pt_idx)
+      skel(points[pt_idx] - offset) = 255;
+  }
+
+protected:
+  //! the value of the pixels of a chain during build_chains()
+  static const uchar TRACED = 1;
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! \return true if \a pt is inside \a skel and non zero
+  static inline bool is_skeleton(const cv::Mat1b & skel, const cv::Point & pt) {
+    return (pt.x >= 0 && pt.y >= 0 && pt.x < skel.cols && pt.y < skel.rows
+            && skel(pt));
+  }
+
+  //! \return the number of non zero 8-neighbours of \a pt
+  static inline int nneighbours(const cv::Mat1b & skel, const cv::Point & pt) {
+    int n = 0;
+    for (int code = 0; code < 8; ++code)
+      n += is_skeleton(skel, pt + move(code));
+    return n;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! add the chain starting at \a pt, that goes on while there is a
+   * neighbour not traced yet, the 4-neighbours first */
+  void trace_chain(cv::Mat1b & skel, cv::Point pt, const cv::Point & offset) {
+    static const int order[8] = {0, 2, 4, 6, 1, 3, 5, 7};
+    Chain chain;
+    chain.start = pt + offset;
+    chain.first_code = chain_codes.size();
+    skel(pt) = TRACED;
+    while (true) {
+      int next = -1;
+      for (int order_idx = 0; order_idx < 8 && next < 0; ++order_idx) {
+        cv::Point neigh = pt + move(order[order_idx]);
+        if (is_skeleton(skel, neigh) && skel(neigh) == 255)
+          next = order[order_idx];
+      } // end loop order_idx
+      if (next < 0)
+        break;
+      pt += move(next);
+      skel(pt) = TRACED;
+      chain_codes.push_back(next);
+    } // end while (true)
+    chain.ncodes = chain_codes.size() - chain.first_code;
+    chains.push_back(chain);
+  }
+}; // end struct SparseSkeleton
+
+#endif // SPARSE_SKELETON_H
@@ -24,11 +24,20 @@ Some tests for VoronoiThinner
 
  */
 #include <gtest/gtest.h>
+#include <errno.h> // EEXIST
+#include <map>
+#include <random>
+#include <thread>
+#include <sys/stat.h> // mkdir
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp> // for erode
 #include "timer.h"
 
-#include "voronoi.h"
+#include "avi_writer.h"
+#include "voronoi_batch.h"
+#include "voronoi_shared.h"
+#include "voronoi_stream.h"
+#include "voronoi_strip.h"
 
 //int codec = CV_FOURCC('M', 'P', '4', '2');
 int codec = CV_FOURCC('M', 'J', 'P', 'G');
@@ -44,12 +53,15 @@ public:
             std::string implementation_name_,
             bool crop_img_before_) {
     _implementation_name = implementation_name_;
+    _implementation = VoronoiThinner::implementation_id(_implementation_name);
     _crop_img_before = crop_img_before_;
-    _first_img = query.clone();
-    VoronoiThinner::copy_bounding_box_plusone(query, _first_img, true);
-    _curr_skel = _first_img.clone();
+    cv::Rect bbox = VoronoiThinner::copy_bounding_box_plusone(query, _first_img, true);
+    // without the virtual border, as VoronoiThinner::get_bbox()
+    cv::Rect inside = bbox & cv::Rect(0, 0, query.cols, query.rows);
+    _first_img = _first_img(cv::Rect(inside.x - bbox.x, inside.y - bbox.y,
+                                     inside.width, inside.height)).clone();
     // printf("first_img:%s\n", image_utils::infosImage(_first_img).c_str());
-    _curr_iter = 1;
+    _thinner.begin(_first_img, _implementation, false); // already cropped
     _nframes = 0;
   }
 
@@ -73,17 +85,13 @@ public:
     return _contour_viz.illus().clone();
   }
 
-  //! \return true if success
+  //! one more iteration, the working images are kept. \return true if success
   bool iter() {
     ++_nframes;
-    bool reuse = (_implementation_name != IMPL_MORPH); // cant reuse with morph implementation
-    bool success = false;
-    if (reuse)
-      success = _thinner.thin(_curr_skel, _implementation_name, false, 1); // already cropped
-    else
-      success = _thinner.thin(_first_img, _implementation_name, false, _nframes); // already cropped
-    _thinner.get_skeleton().copyTo(_curr_skel);
-    return success;
+    if (!_thinner.step(1))
+      return false;
+    _thinner.current();
+    return true;
   }
 
   inline bool has_converged() const { return _thinner.has_converged(); }
@@ -93,11 +101,10 @@ public:
 
   //protected:
   std::string _implementation_name;
+  int _implementation;
   bool _crop_img_before;
   int _nframes;
-  int _curr_iter;
   cv::Mat1b _first_img;
-  cv::Mat1b _curr_skel;
   VoronoiThinner _thinner;
   ImageContour _contour_viz;
 }; // end class VoronoiIterator
@@ -208,6 +215,10 @@ void generate_video_comparer(const cv::Mat1b & query,
   out_filename << out_prefix << ".avi";
   cv::VideoWriter writer(out_filename.str(), codec, fps, output_size, true); // color
   assert(writer.isOpened());
+  // lossless copy, encoded while thinning
+  std::ostringstream out_filename_lossless;
+  out_filename_lossless << out_prefix << "_lossless.avi";
+  AviWriter lossless_writer;
   unsigned int n_terminated = 0, iters = 0;
   while(n_terminated < nimpls) {
     ++iters;
@@ -232,29 +243,18 @@ void generate_video_comparer(const cv::Mat1b & query,
     paste_images_gallery(curr_imgs, curr, gallerycols, cv::Vec3b(0, 0, 0), true, CV_RGB(255, 255, 255));
     cv::resize(curr, curr_resized, output_size, CV_INTER_NN);
     writer << curr_resized;
+    if (!lossless_writer.is_opened())
+      lossless_writer.open(out_filename_lossless.str(), curr.size(), fps);
+    lossless_writer << curr;
     cv::imshow("curr", curr); cv::waitKey(10);
-    // http://denislantsman.com/?p=111 - save as png too
-    // convert: ffmpeg -i out_%d.png -vcodec png out.avi
-    // http://stackoverflow.com/questions/4839303/convert-image-sequence-to-lossless-movie
-    std::ostringstream name; name << "comparer_" << std::setprecision(3) << std::setfill('0') << iters << ".png";
-    cv::imwrite(name.str(), curr);
   } // end while1
   // add the last image for twp second
   for (unsigned int i = 0; i < 2 * fps; ++i) {
     writer << curr_resized;
-    std::ostringstream name; name << "comparer_" << std::setprecision(3) << std::setfill('0') << ++iters << ".png";
-    cv::imwrite(name.str(), curr);
+    lossless_writer << curr;
+    ++iters;
   } // end loop i
-
-  std::ostringstream out_filename_lossless;
-  out_filename_lossless << out_prefix << "_lossless.avi";
-  std::ostringstream command;
-  command << "ffmpeg -r " << fps << " -y -i comparer_%d.png "
-          << " -vcodec png "
-             //<< " -vcodec huffyuv "
-             // << " -vcodec mjpeg "
-          << out_filename_lossless.str() << "; rm comparer_*.png";
-  system(command.str().c_str());
+  lossless_writer.close();
 
   printf("generated '%s' and '%s' (%i frames, %ix%i)\n",
          out_filename.str().c_str(), out_filename_lossless.str().c_str(),
@@ -276,8 +276,9 @@ void benchmark(const cv::Mat1b & query,
   for (unsigned int i = 0; i < impls.size(); ++i) {
     for (unsigned int crop = 0; crop <= 1; ++crop) {
       timer.reset();
+      int implementation = VoronoiThinner::implementation_id(impls[i]);
       for (unsigned int time = 0; time < ntimes; ++time)
-        thinner.thin(query, impls[i], crop);
+        thinner.thin(query, implementation, crop);
       printf("Time for thin('%s', crop:%i):\t %g ms\n",
              impls[i].c_str(), crop, timer.getTimeMilliseconds() / ntimes);
       if (crop)
@@ -309,6 +310,7 @@ void benchmark_logs(const cv::Mat1b & query) {
   implementation_names.push_back(IMPL_ZHANG_SUEN_FAST);
   implementation_names.push_back(IMPL_GUO_HALL);
   implementation_names.push_back(IMPL_GUO_HALL_FAST);
+  implementation_names.push_back(IMPL_DISTANCE_TRANSFORM);
   std::cout << "npixels \t";
   for (unsigned int imp_idx = 0; imp_idx < implementation_names.size(); ++imp_idx)
     std::cout << implementation_names[imp_idx] << " \t";
@@ -335,30 +337,334 @@ void benchmark_logs(const cv::Mat1b & query) {
 
 ////////////////////////////////////////////////////////////////////////////////
 
+/*! \return the names of the skeletons of \a filenames in \a output_dir:
+ * "<output_dir>/<name>_skel.png" for "<dir>/<name>.<ext>".
+ * When several files have the same name, their index is appended: "<name>_<i>_skel.png".
+ */
+std::vector<std::string> skeleton_filenames(const std::vector<std::string> & filenames,
+                                            const std::string & output_dir) {
+  std::vector<std::string> names(filenames.size());
+  std::map<std::string, int> name_counts;
+  for (unsigned int file_idx = 0; file_idx < filenames.size(); ++file_idx) {
+    const std::string & filename = filenames[file_idx];
+    size_t slash = filename.find_last_of("/\\");
+    names[file_idx] = filename.substr(slash == std::string::npos ? 0 : slash + 1);
+    size_t dot = names[file_idx].find_last_of('.');
+    if (dot != std::string::npos && dot > 0)
+      names[file_idx].erase(dot);
+    ++name_counts[names[file_idx]];
+  } // end loop file_idx
+  for (unsigned int file_idx = 0; file_idx < filenames.size(); ++file_idx) {
+    std::ostringstream out;
+    out << output_dir << "/" << names[file_idx];
+    if (name_counts[names[file_idx]] > 1)
+      out << "_" << file_idx;
+    out << "_skel.png";
+    names[file_idx] = out.str();
+  } // end loop file_idx
+  return names;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/*! thin the files \a filenames without any display,
+ * reading, thinning and writing them concurrently, \see thin_pipelined().
+ * The skeleton of each file is written in \a output_dir, \see skeleton_filenames().
+ * \return the number of files that could not be read, thinned or written,
+ *    -1 if \a output_dir can not be created
+ */
+int thin_files_batch(const std::vector<std::string> & filenames,
+                     const std::string & implementation_name,
+                     const std::string & output_dir) {
+  if (mkdir(output_dir.c_str(), 0755) != 0 && errno != EEXIST) {
+    printf("Could not create the output directory '%s'\n", output_dir.c_str());
+    return -1;
+  }
+  std::vector<std::string> skel_filenames = skeleton_filenames(filenames, output_dir);
+  VoronoiBatchThinner batch;
+  unsigned int next_file = 0;
+  int nfailures = 0;
+  long npixels = 0;
+  double read_ms = 0, write_ms = 0;
+  Timer timer;
+  batch.thin_pipelined([&](cv::Mat1b & img) {
+    if (next_file >= filenames.size())
+      return false;
+    Timer read_timer;
+    const std::string & filename = filenames[next_file++];
+    img = cv::imread(filename, CV_LOAD_IMAGE_GRAYSCALE);
+    if (img.empty())
+      printf("Could not load file '%s'\n", filename.c_str());
+    npixels += img.rows * img.cols;
+    read_ms += read_timer.getTimeMilliseconds();
+    return true;
+  }, [&](int img_idx, bool success, const cv::Mat1b & skel, const cv::Rect & /*bbox*/) {
+    if (!success) {
+      printf("Failed thinning '%s'\n", filenames[img_idx].c_str());
+      ++nfailures;
+      return;
+    }
+    Timer write_timer;
+    if (!cv::imwrite(skel_filenames[img_idx], skel)) {
+      printf("Could not write file '%s'\n", skel_filenames[img_idx].c_str());
+      ++nfailures;
+    }
+    write_ms += write_timer.getTimeMilliseconds();
+  }, implementation_name, true);
+  double total_ms = timer.getTimeMilliseconds();
+  printf("Batch of %i files with %s (%i threads): %i failed, %g ms, "
+         "%g files/s, %g Mpixels/s (reading: %g ms, writing: %g ms)\n",
+         (int) filenames.size(), implementation_name.c_str(),
+         batch.get_nthreads(), nfailures, total_ms,
+         1000. * filenames.size() / total_ms, 1E-3 * npixels / total_ms,
+         read_ms, write_ms);
+  return nfailures;
+} // end thin_files_batch();
+
+////////////////////////////////////////////////////////////////////////////////
+
+/*!
+ * draw random strokes in an image of random size, for check_implementations():
+ * strokes of random thickness and grey level, some of them at most
+ * VoronoiThinner::THRESHOLD, some of them black to carve holes,
+ * and some of them touching the edges of the image.
+ * The same seed always gives the same image.
+ */
+cv::Mat1b generate_check_image(unsigned int seed) {
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> size(1, 150), nstrokes(1, 8),
+      thickness(1, 20), value(0, 255);
+  cv::Mat1b img(size(rng), size(rng));
+  img.setTo(0);
+  std::uniform_int_distribution<int> col(-10, img.cols + 10), row(-10, img.rows + 10);
+  int nstrokes_img = nstrokes(rng);
+  for (int stroke = 0; stroke < nstrokes_img; ++stroke) {
+    cv::Point p1(col(rng), row(rng)), p2(col(rng), row(rng));
+    // mostly white strokes, then black, faint and grey ones
+    int stroke_value = value(rng);
+    if (stroke == 0 || stroke_value > 128)
+      stroke_value = 255;
+    else if (stroke_value > 96)
+      stroke_value = 0;
+    cv::line(img, p1, p2, cv::Scalar(stroke_value), thickness(rng));
+  } // end loop stroke
+  return img;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/*! \return the implementation whose skeletons \a implementation must give,
+ * for instance VoronoiThinner::ZHANG_SUEN for VoronoiThinner::ZHANG_SUEN_FAST
+ */
+inline int reference_implementation(int implementation) {
+  switch (implementation) {
+    case VoronoiThinner::GUO_HALL_ORIGINAL:
+    case VoronoiThinner::GUO_HALL_FAST:
+    case VoronoiThinner::GUO_HALL_BITBOARD:
+      return VoronoiThinner::GUO_HALL;
+    case VoronoiThinner::ZHANG_SUEN_ORIGINAL:
+    case VoronoiThinner::ZHANG_SUEN_FAST:
+    case VoronoiThinner::ZHANG_SUEN_BITBOARD:
+      return VoronoiThinner::ZHANG_SUEN;
+    default:
+      return implementation;
+  } // end switch (implementation)
+}
+
+//! \return true if \a A and \a B have the same size and the same pixels
+inline bool same_images(const cv::Mat1b & A, const cv::Mat1b & B) {
+  if (A.size() != B.size())
+    return false;
+  for (int row = 0; row < A.rows; ++row) {
+    if (memcmp(A.ptr(row), B.ptr(row), A.cols))
+      return false;
+  } // end loop row
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/*! check that the skeletons do not depend on the optimizations:
+ * on \a nimages random images, \see generate_check_image(),
+ * thin with each builtin implementation, each instruction set supported
+ * by the CPU and 1, 3 or 8 threads, with and without cropping,
+ * and compare with reference_implementation() on RowKernels::SCALAR
+ * and a single thread.
+ * The skeleton, bounding box and convergence must be identical
+ * after 1, 2, 5 iterations and at convergence.
+ * The original and fast implementations do not count the iterations
+ * as the others: they are only compared at convergence.
+ * \return the number of differences, -1 if thinning failed
+ */
+int check_implementations(int nimages) {
+  printf("Checking the implementations on %i images, instructions up to %s\n",
+         nimages, RowKernels::instructions_name(RowKernels::best_instructions()));
+  VoronoiThinner reference, thinners[3];
+  reference.set_instructions(RowKernels::SCALAR);
+  const int nthreads[] = {1, 3, 8};
+  for (unsigned int thread_idx = 0; thread_idx < 3; ++thread_idx)
+    thinners[thread_idx].set_nthreads(nthreads[thread_idx]);
+  const int max_iters[] = {1, 2, 5, VoronoiThinner::NOLIMIT};
+  int nchecks = 0, ndiffs = 0;
+  for (int img_idx = 0; img_idx < nimages; ++img_idx) {
+    cv::Mat1b img = generate_check_image(img_idx);
+    for (int impl = 0; impl < VoronoiThinner::NBUILTIN_IMPLEMENTATIONS; ++impl) {
+      bool only_converged = (impl == VoronoiThinner::GUO_HALL_ORIGINAL
+                             || impl == VoronoiThinner::GUO_HALL_FAST
+                             || impl == VoronoiThinner::ZHANG_SUEN_ORIGINAL
+                             || impl == VoronoiThinner::ZHANG_SUEN_FAST);
+      for (unsigned int crop = 0; crop <= 1; ++crop) {
+        for (unsigned int iter_idx = 0; iter_idx < 4; ++iter_idx) {
+          int iters = max_iters[iter_idx];
+          if (only_converged && iters != VoronoiThinner::NOLIMIT)
+            continue;
+          if (!reference.thin(img, reference_implementation(impl), crop, iters)) {
+            printf("Failed thinning image %i with implementation '%s'\n", img_idx,
+                   VoronoiThinner::implementation_name(reference_implementation(impl)).c_str());
+            return -1;
+          }
+          for (int instr = RowKernels::SCALAR; instr <= RowKernels::best_instructions(); ++instr) {
+            for (unsigned int thread_idx = 0; thread_idx < 3; ++thread_idx) {
+              VoronoiThinner & thinner = thinners[thread_idx];
+              thinner.set_instructions((RowKernels::Instructions) instr);
+              ++nchecks;
+              if (thinner.thin(img, impl, crop, iters)
+                  && same_images(thinner.get_skeleton(), reference.get_skeleton())
+                  && thinner.get_bbox() == reference.get_bbox()
+                  && thinner.has_converged() == reference.has_converged())
+                continue;
+              ++ndiffs;
+              printf("Difference on image %i (%ix%i): implementation '%s', "
+                     "instructions %s, %i threads, crop %i, max_iters %i\n",
+                     img_idx, img.cols, img.rows,
+                     VoronoiThinner::implementation_name(impl).c_str(),
+                     RowKernels::instructions_name(thinner.get_instructions()),
+                     thinner.get_nthreads(), crop, iters);
+            } // end loop thread_idx
+          } // end loop instr
+        } // end loop iter_idx
+      } // end loop crop
+    } // end loop impl
+  } // end loop img_idx
+  printf("%i checks, %i differences\n", nchecks, ndiffs);
+  return ndiffs;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/*! check that a VoronoiSharedThinner gives the results of a VoronoiThinner
+ * when \a nthreads threads call it concurrently:
+ * for each builtin implementation, with and without cropping,
+ * each thread thins the \a nimages random images in its own order,
+ * alternating both versions of VoronoiSharedThinner::thin().
+ * The pool has fewer thinners than threads, so that thinners are also
+ * built and deleted while thinning.
+ * \return the number of differences
+ */
+int check_shared_thinner(int nimages, int nthreads = 6) {
+  printf("Checking VoronoiSharedThinner on %i images with %i threads\n",
+         nimages, nthreads);
+  std::vector<cv::Mat1b> imgs;
+  for (int img_idx = 0; img_idx < nimages; ++img_idx)
+    imgs.push_back(generate_check_image(img_idx));
+  VoronoiThinner reference;
+  reference.set_sparse_outputs(SparseSkeleton::RUNS);
+  // the pooled thinners are configured as the prototype
+  VoronoiThinner prototype;
+  prototype.set_instructions(RowKernels::SCALAR);
+  prototype.set_nthreads(2);
+  prototype.set_sparse_outputs(SparseSkeleton::RUNS);
+  std::atomic<int> nchecks(0), ndiffs(0);
+  for (int impl = 0; impl < VoronoiThinner::NBUILTIN_IMPLEMENTATIONS; ++impl) {
+    std::string implementation_name = VoronoiThinner::implementation_name(impl);
+    for (unsigned int crop = 0; crop <= 1; ++crop) {
+      std::vector<VoronoiSharedThinner::Result> refs(nimages);
+      for (int img_idx = 0; img_idx < nimages; ++img_idx) {
+        VoronoiSharedThinner::Result & ref = refs[img_idx];
+        ref.success = reference.thin(imgs[img_idx], impl, crop);
+        ref.skel = reference.get_skeleton().clone();
+        ref.bbox = reference.get_bbox();
+        ref.has_converged = reference.has_converged();
+        ref.sparse = reference.get_sparse_skeleton();
+      } // end loop img_idx
+      const VoronoiSharedThinner shared(prototype, implementation_name, crop,
+                                        VoronoiThinner::NOLIMIT, std::max(nthreads / 2, 1));
+      std::vector<std::thread> threads;
+      for (int thread_idx = 0; thread_idx < nthreads; ++thread_idx) {
+        threads.push_back(std::thread([&, thread_idx]() {
+          VoronoiSharedThinner::Result res;
+          for (int call = 0; call < 2 * nimages; ++call) {
+            int img_idx = (call * (2 * thread_idx + 1) + thread_idx) % nimages;
+            if (call % 2)
+              res.success = shared.thin(imgs[img_idx], res.skel, res.bbox,
+                                        &res.has_converged, &res.sparse);
+            else
+              res = shared.thin(imgs[img_idx]);
+            const VoronoiSharedThinner::Result & ref = refs[img_idx];
+            ++nchecks;
+            if (res.success == ref.success
+                && (!res.success || (same_images(res.skel, ref.skel)
+                                     && res.bbox == ref.bbox
+                                     && res.has_converged == ref.has_converged
+                                     && res.sparse.runs.size() == ref.sparse.runs.size())))
+              continue;
+            ++ndiffs;
+            printf("Difference on image %i: implementation '%s', crop %i, thread %i\n",
+                   img_idx, implementation_name.c_str(), crop, thread_idx);
+          } // end loop call
+        }));
+      } // end loop thread_idx
+      for (int thread_idx = 0; thread_idx < nthreads; ++thread_idx)
+        threads[thread_idx].join();
+    } // end loop crop
+  } // end loop impl
+  printf("%i checks, %i differences\n", (int) nchecks, (int) ndiffs);
+  return ndiffs;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 inline int CLI_help(int argc, char** argv) {
   printf("Usage: %s <command> <implementation_name> <files>\n", argv[0]);
-  printf(" * command: [ thin | video | video_bright | video_comparer | benchmark ]\n");
+  printf(" * command: [ thin | batch | stream | strip | video | video_bright | video_comparer | benchmark | check ]\n");
+  printf("   batch thins the files without display, reading and writing them while thinning.\n");
+  printf("   Their skeletons are written as '<name>_skel.png' in the directory given by '--output-dir <dir>' (default: '.').\n");
+  printf("   stream thins the files as the consecutive frames of a video.\n");
+  printf("   strip thins binary PGM files by strips of rows, without loading them.\n");
+  printf("   check compares all the implementations, instructions and numbers of threads\n");
+  printf("   with the scalar reference on random images: '%s check [nimages]' (default: 100).\n", argv[0]);
+  printf("   It also compares the results of a VoronoiSharedThinner shared by several threads.\n");
   printf("   If command =  video_comparer or benchmark, no implementation must be specified.\n");
   printf(" * implementation_name: [%s]\n",
          VoronoiThinner::all_implementations_as_string().c_str());
   printf("\nExamples:\n");
   printf("  %s video           morph            horse.png\n", argv[0]);
   printf("  %s thin            zhang_suen_fast  *.png\n", argv[0]);
+  printf("  %s batch           zhang_suen_fast  --output-dir skels *.png\n", argv[0]);
+  printf("  %s stream          zhang_suen_fast  frame*.png\n", argv[0]);
+  printf("  %s strip           zhang_suen       map.pgm\n", argv[0]);
   printf("  %s video_comparer                   *.png\n", argv[0]);
+  printf("  %s check                            500\n", argv[0]);
   return -1;
 }
 
-enum {THIN, VIDEO, VIDEO_BRIGHT, VIDEO_COMPARER, BENCHMARK};
+enum {THIN, BATCH, STREAM, STRIP, VIDEO, VIDEO_BRIGHT, VIDEO_COMPARER, BENCHMARK, CHECK};
 int CLI(int argc, char** argv) {
   //  for (int argi = 0; argi < argc; ++argi)
   //    printf("argv[%i]:'%s'\n", argi, argv[argi]);
-  if (argc < 3) // [exename] + 2 args
+  if (argc < 2) // [exename] + order
     return CLI_help(argc, argv);
   // detect order
   int order = -1;
   std::string order_str (argv[1]);
   if (order_str == "thin")
     order = THIN;
+  else if (order_str == "batch")
+    order = BATCH;
+  else if (order_str == "stream")
+    order = STREAM;
+  else if (order_str == "strip")
+    order = STRIP;
   else if (order_str == "video")
     order = VIDEO;
   else if (order_str == "video_bright")
@@ -367,10 +673,20 @@ int CLI(int argc, char** argv) {
     order = VIDEO_COMPARER;
   else if (order_str == "benchmark")
     order = BENCHMARK;
+  else if (order_str == "check")
+    order = CHECK;
   else {
     printf("Unknown order '%s'\n", order_str.c_str());
     return CLI_help(argc, argv);
   }
+  if (order == CHECK) { // [exename] [order] ([nimages])
+    int nimages = (argc > 2 ? atoi(argv[2]) : 100);
+    bool ok = (check_implementations(nimages) == 0);
+    ok = (check_shared_thinner(nimages) == 0) && ok;
+    return (ok ? 0 : -1);
+  } // end if (order == CHECK)
+  if (argc < 3) // [exename] + 2 args
+    return CLI_help(argc, argv);
   // check implementation
   std::string implementation_name (argv[2]);
   int first_file_idx = 2;
@@ -384,6 +700,39 @@ int CLI(int argc, char** argv) {
   if (argc < first_file_idx + 1) // [exename] [order] [file(s)]
     return CLI_help(argc, argv);
 
+  if (order == STRIP) {
+    // the files are too big to be loaded
+    VoronoiStripThinner strip(implementation_name);
+    for (int argi = first_file_idx; argi < argc; ++argi) {
+      std::ostringstream out; out << "out_" << argi - first_file_idx << ".pgm";
+      Timer timer;
+      if (!strip.thin_pgm(argv[argi], out.str()))
+        return -1;
+      if (!strip.has_converged()) {
+        printf("Thinning '%s' did not converge\n", argv[argi]);
+        return -1;
+      }
+      printf("Time for '%s' (%li rows, %i passes): %g ms.\n", argv[argi],
+             (long) strip.get_nrows(), strip.get_npasses(),
+             timer.getTimeMilliseconds());
+      printf("Written file '%s'\n", out.str().c_str());
+    } // end loop argi
+    return 0;
+  } // end if (order == STRIP)
+
+  if (order == BATCH) {
+    // the files are read while thinning
+    std::string output_dir = ".";
+    std::vector<std::string> filenames;
+    for (int argi = first_file_idx; argi < argc; ++argi) {
+      if (std::string(argv[argi]) == "--output-dir" && argi + 1 < argc)
+        output_dir = argv[++argi];
+      else
+        filenames.push_back(argv[argi]);
+    } // end loop argi
+    return (thin_files_batch(filenames, implementation_name, output_dir) == 0 ? 0 : -1);
+  } // end if (order == BATCH)
+
   VoronoiThinner thinner;
   // load files
   std::vector<cv::Mat1b> files;
@@ -396,7 +745,29 @@ int CLI(int argc, char** argv) {
   } // end loop argi
 
   // process
-  if (order == THIN) {
+  if (order == THIN && files.size() > 1) {
+    // thin all files concurrently
+    VoronoiBatchThinner batch;
+    std::vector<cv::Mat1b> skels;
+    std::vector<cv::Rect> bboxes;
+    Timer timer;
+    batch.thin(files, skels, bboxes, implementation_name, true);
+    printf("Time for %s (%i files, %i threads): %g ms.\n",
+           implementation_name.c_str(), (int) files.size(),
+           batch.get_nthreads(), timer.getTimeMilliseconds());
+    for (unsigned int file_idx = 0; file_idx < files.size(); ++file_idx) {
+      // write file
+      std::ostringstream out; out << "out_" << file_idx << ".png";
+      cv::imwrite(out.str(), skels[file_idx]);
+      printf("Written file '%s'\n", out.str().c_str());
+      // show res
+      cv::imshow("query", files[file_idx]);
+      cv::imshow(implementation_name, skels[file_idx]);
+      cv::waitKey(0);
+    } // end loop file_idx
+  } // end if (order == THIN && files.size() > 1)
+
+  else if (order == THIN) {
     for (unsigned int file_idx = 0; file_idx < files.size(); ++file_idx) {
       Timer timer;
       bool ok = thinner.thin(files[file_idx], implementation_name, true);
@@ -416,6 +787,23 @@ int CLI(int argc, char** argv) {
     } // end loop file_idx
   } // end if (order == THIN)
 
+  else if (order == STREAM) {
+    VoronoiStreamThinner stream(implementation_name);
+    for (unsigned int file_idx = 0; file_idx < files.size(); ++file_idx) {
+      Timer timer;
+      if (!stream.thin(files[file_idx])) {
+        printf("Failed thinning with implementation '%s'\n", implementation_name.c_str());
+        return -1;
+      }
+      printf("Time for frame %i (%s): %g ms.\n", file_idx,
+             (stream.was_incremental() ? "incremental" : "full"),
+             timer.getTimeMilliseconds());
+      // write file
+      std::ostringstream out; out << "out_" << file_idx << ".png";
+      cv::imwrite(out.str(), stream.get_skeleton());
+    } // end loop file_idx
+  } // end if (order == STREAM)
+
   else if (order == VIDEO || order == VIDEO_BRIGHT) {
     for (unsigned int file_idx = 0; file_idx < files.size(); ++file_idx)
       generate_video_bw(files[file_idx], implementation_name,
@@ -0,0 +1,132 @@
+/*!
+  \file        thinning_stats.h
+  \author      Arnaud Ramey <arnaud.a.ramey@gmail.com>
+                -- Robotics Lab, University Carlos III of Madrid
+  \date        2026/10/18
+
+________________________________________________________________________________
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+________________________________________________________________________________
+
+\struct ThinningStats gathers what happened during a call to
+VoronoiThinner::thin(): number of iterations, pixels visited and deleted,
+size of the contour, area of the bounding box and time of each stage.
+
+The statistics cost some time, so they are only computed if
+VORONOI_ENABLE_STATS is defined before including voronoi.h,
+for instance with -DVORONOI_ENABLE_STATS.
+Otherwise, the counters are not compiled and all the statistics are zero.
+
+ */
+
+#ifndef THINNING_STATS_H
+#define THINNING_STATS_H
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef VORONOI_ENABLE_STATS
+//! the statement \a x is only compiled if the statistics are enabled
+#define VORONOI_STATS(x) x
+#else // VORONOI_ENABLE_STATS
+#define VORONOI_STATS(x)
+#endif // VORONOI_ENABLE_STATS
+
+struct ThinningStats {
+#ifdef VORONOI_ENABLE_STATS
+  static const bool ENABLED = true;
+#else // VORONOI_ENABLE_STATS
+  static const bool ENABLED = false;
+#endif // VORONOI_ENABLE_STATS
+
+  //! the number of calls to thin()
+  long ncalls;
+  /*! the number of passes on the image: one per sub-iteration
+   * for Zhang-Suen and Guo-Hall, one per erosion for the morphological one */
+  long niters;
+  //! the number of pixels whose neighbourhood was examined
+  long npixels_visited;
+  //! the number of non-zero pixels that are not in the skeleton
+  long npixels_deleted;
+  /*! for the contour-based implementations (the fast ones),
+   * the size of the contour at each sub-iteration.
+   * Added element by element by operator+=(). */
+  std::vector<long> contour_sizes;
+  //! the number of pixels of the input image
+  long input_area;
+  //! the number of pixels of the bounding box that was thinned
+  long bbox_area;
+  //! the time to threshold and crop the image, in milliseconds
+  double preprocessing_ms;
+  //! the time of the iterations, in milliseconds
+  double iterations_ms;
+  //! the time to convert the result into the skeleton, in milliseconds
+  double output_ms;
+
+  ThinningStats() { reset(); }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  void reset() {
+    ncalls = niters = npixels_visited = npixels_deleted = 0;
+    contour_sizes.clear();
+    input_area = bbox_area = 0;
+    preprocessing_ms = iterations_ms = output_ms = 0;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! add the statistics of other calls
+  ThinningStats & operator+=(const ThinningStats & other) {
+    ncalls += other.ncalls;
+    niters += other.niters;
+    npixels_visited += other.npixels_visited;
+    npixels_deleted += other.npixels_deleted;
+    if (contour_sizes.size() < other.contour_sizes.size())
+      contour_sizes.resize(other.contour_sizes.size(), 0);
+    for (unsigned int iter = 0; iter < other.contour_sizes.size(); ++iter)
+      contour_sizes[iter] += other.contour_sizes[iter];
+    input_area += other.input_area;
+    bbox_area += other.bbox_area;
+    preprocessing_ms += other.preprocessing_ms;
+    iterations_ms += other.iterations_ms;
+    output_ms += other.output_ms;
+    return *this;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! \return the statistics as "key:value" pairs, one per line
+  std::string to_string() const {
+    std::ostringstream out;
+    out << "ncalls:" << ncalls << std::endl
+        << "niters:" << niters << std::endl
+        << "npixels_visited:" << npixels_visited << std::endl
+        << "npixels_deleted:" << npixels_deleted << std::endl
+        << "contour_sizes:";
+    for (unsigned int iter = 0; iter < contour_sizes.size(); ++iter)
+      out << (iter ? "," : "") << contour_sizes[iter];
+    out << std::endl
+        << "input_area:" << input_area << std::endl
+        << "bbox_area:" << bbox_area << std::endl
+        << "preprocessing_ms:" << preprocessing_ms << std::endl
+        << "iterations_ms:" << iterations_ms << std::endl
+        << "output_ms:" << output_ms << std::endl;
+    return out.str();
+  }
+}; // end struct ThinningStats
+
+#endif // THINNING_STATS_H
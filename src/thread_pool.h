@@ -0,0 +1,173 @@
+/*!
+  \file        thread_pool.h
+  \author      Arnaud Ramey <arnaud.a.ramey@gmail.com>
+                -- Robotics Lab, University Carlos III of Madrid
+  \date        2026/10/18
+
+________________________________________________________________________________
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+________________________________________________________________________________
+
+A pool of worker threads running the tasks of parallel loops.
+Each worker has its own queue of tasks, and steals the tasks of the others
+when its queue is empty.
+
+ */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+  //! a task of a parallel loop: the index of the task, the index of the worker
+  typedef std::function<void(int, int)> TaskFn;
+
+  /*! \param nthreads
+   *  the number of worker threads.
+   *  If <= 1, no thread is created and the tasks are run by the caller.
+   */
+  explicit ThreadPool(int nthreads)
+    : _fn(NULL), _remaining(0), _generation(0), _stop(false) {
+    if (nthreads <= 1)
+      return;
+    for (int worker = 0; worker < nthreads; ++worker)
+      _queues.push_back(std::unique_ptr<Queue>(new Queue()));
+    for (int worker = 0; worker < nthreads; ++worker)
+      _threads.push_back(std::thread(&ThreadPool::worker_loop, this, worker));
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stop = true;
+    }
+    _wake.notify_all();
+    for (unsigned int i = 0; i < _threads.size(); ++i)
+      _threads[i].join();
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! \return the number of workers, the index of a worker is in [0, size())
+  inline int size() const { return (_threads.empty() ? 1 : _threads.size()); }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! call fn(task, worker) for all tasks in [0, ntasks), and return
+   * when they are all done. The tasks are distributed in contiguous blocks
+   * to the workers. Not reentrant: one parallel_for() at a time.
+   */
+  void parallel_for(int ntasks, const TaskFn & fn) {
+    if (ntasks <= 0)
+      return;
+    if (_threads.empty() || ntasks == 1) {
+      for (int task = 0; task < ntasks; ++task)
+        fn(task, 0);
+      return;
+    }
+    std::unique_lock<std::mutex> lock(_mutex);
+    _fn = &fn;
+    _remaining = ntasks;
+    int nworkers = _queues.size();
+    for (int worker = 0; worker < nworkers; ++worker) {
+      Queue & queue = *_queues[worker];
+      std::lock_guard<std::mutex> queue_lock(queue.mutex);
+      for (int task = worker * ntasks / nworkers;
+           task < (worker + 1) * ntasks / nworkers; ++task)
+        queue.tasks.push_back(task);
+    } // end loop worker
+    ++_generation;
+    _wake.notify_all();
+    _done.wait(lock, [this] { return _remaining == 0; });
+    _fn = NULL;
+  }
+
+private:
+  //////////////////////////////////////////////////////////////////////////////
+
+  struct Queue {
+    std::mutex mutex;
+    std::deque<int> tasks;
+  };
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! take a task from the front of the own queue, or steal one at the back of another
+  bool pop_task(int worker, int & task) {
+    int nworkers = _queues.size();
+    for (int offset = 0; offset < nworkers; ++offset) {
+      Queue & queue = *_queues[(worker + offset) % nworkers];
+      std::lock_guard<std::mutex> queue_lock(queue.mutex);
+      if (queue.tasks.empty())
+        continue;
+      if (offset == 0) {
+        task = queue.tasks.front();
+        queue.tasks.pop_front();
+      }
+      else {
+        task = queue.tasks.back();
+        queue.tasks.pop_back();
+      }
+      return true;
+    } // end loop offset
+    return false;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  void worker_loop(int worker) {
+    unsigned int generation = 0;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _wake.wait(lock, [this, generation] { return _stop || _generation != generation; });
+        if (_stop)
+          return;
+        generation = _generation;
+      }
+      int task;
+      while (pop_task(worker, task)) {
+        // _fn was set before the task was queued
+        (*_fn)(task, worker);
+        if (--_remaining == 0) {
+          std::lock_guard<std::mutex> lock(_mutex);
+          _done.notify_all();
+        }
+      } // end while (pop_task())
+    } // end while (true)
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  std::vector<std::thread> _threads;
+  std::vector<std::unique_ptr<Queue> > _queues;
+  std::mutex _mutex;
+  std::condition_variable _wake, _done;
+  const TaskFn* _fn;
+  std::atomic<int> _remaining;
+  unsigned int _generation;
+  bool _stop;
+}; // end class ThreadPool
+
+#endif // THREAD_POOL_H
@@ -48,20 +48,45 @@ It contains different implementations of thinning algorithms:
   Coming from:
   \link http://felix.abecassis.me/2011/09/opencv-morphological-skeleton/
 
+* a distance-ordered one, that visits the pixels once by increasing
+  Euclidean distance to the background: its time does not depend
+  on the thickness of the shape.
+
 A special care has been given to optimize the 2 first ones.
 Instead of re-examining the whole image at each iteration,
-only the pixels of the current contour are considered.
+only the pixels of the current contour are considered:
+they are kept in a worklist, and the pixels exposed by each deletion
+are pushed to the worklist of the next iteration.
 
 This leads to a speedup by almost 100 times on experimental tests.
 
+Zhang - Suen and Guo - Hall also have a bit-packed implementation,
+storing one pixel per bit and processing 64 pixels at once.
+Their raster implementations use SSE2, AVX2 or AVX-512BW row kernels,
+chosen at runtime according to the CPU (\see RowKernels),
+and can split each sub-iteration in bands of rows processed by several threads
+(\see set_nthreads()).
+
+The implementations are kept in a registry and identified by an index,
+the built-in ones being the values of VoronoiThinner::ImplementationId.
+The names are only needed to find this index, \see implementation_id().
+Other implementations can be added with register_implementation().
+
  */
 
 #ifndef VORONOI_H
 #define VORONOI_H
 
-#include <deque>
+#include <chrono>
+#include <stdint.h> // uint64_t
+#include <string.h> // memset
 #include <opencv2/imgproc/imgproc.hpp>
 #include "image_contour.h"
+#include "row_kernels.h"
+#include "sparse_skeleton.h"
+#include "thinning_stats.h"
+#include "thread_pool.h"
+#include "workspace.h"
 
 #define IMPL_MORPH                "morph"
 #define IMPL_ZHANG_SUEN           "zhang_suen"
@@ -70,16 +95,54 @@ This leads to a speedup by almost 100 times on experimental tests.
 #define IMPL_GUO_HALL             "guo_hall"
 #define IMPL_GUO_HALL_ORIGINAL    "guo_hall_original"
 #define IMPL_GUO_HALL_FAST        "guo_hall_fast"
+#define IMPL_ZHANG_SUEN_BITBOARD  "zhang_suen_bitboard"
+#define IMPL_GUO_HALL_BITBOARD    "guo_hall_bitboard"
+#define IMPL_DISTANCE_TRANSFORM   "distance_transform"
 
 class VoronoiThinner {
 public:
   //! a constant not limiting the number of iterations of an implementation
   static const int NOLIMIT = INT_MAX;
+  //! the pixels of the images to thin > THRESHOLD are part of the shapes
+  static const uchar THRESHOLD = 10;
+
+  //! the indices of the built-in implementations in the registry
+  enum ImplementationId {
+    MORPH = 0,
+    GUO_HALL,
+    GUO_HALL_ORIGINAL,
+    GUO_HALL_FAST,
+    GUO_HALL_BITBOARD,
+    ZHANG_SUEN,
+    ZHANG_SUEN_ORIGINAL,
+    ZHANG_SUEN_FAST,
+    ZHANG_SUEN_BITBOARD,
+    DISTANCE_TRANSFORM,
+    NBUILTIN_IMPLEMENTATIONS
+  };
+
+  /*! an implementation of thin(). It writes the skeleton in
+   * get_skeleton() and sets the results with set_results().
+   * \return true if success
+   */
+  typedef bool (*ImplementationFn)(VoronoiThinner & thinner,
+                                   const cv::Mat1b & img,
+                                   bool crop_img_before,
+                                   int max_iters);
 
   //! default construtor
   VoronoiThinner() {
     _has_converged = false;
-    element = cv::getStructuringElement(cv::MORPH_CROSS, cv::Size(3, 3));
+    _stats_npixels_before = -1;
+    rows_synced = false;
+    _sparse_done = false;
+    bitboard_words = 0;
+    morph_erode_fn = NULL;
+    morph_residue_fn = NULL;
+    _instructions = RowKernels::best_instructions();
+    _nthreads = 1;
+    _step_implementation = -1;
+    _step_niters = 0;
   }
 
   //////////////////////////////////////////////////////////////////////////////
@@ -87,10 +150,14 @@ public:
   /*!
    * thin a given image,
    * \param img
-   *  A monochrome image. All pixels > 0 are considered as part of the shape.
-   * \param implementation_name
-   *  One of the supported implementations.
-   *  \see all_implementations()
+   *  A monochrome image. All pixels > THRESHOLD are considered as part of the shape.
+   *  It can be a ROI of a bigger image: it is not copied, only its
+   *  bounding box is. The shapes touching its edges are thinned as if
+   *  it had a border of zeros.
+   * \param implementation
+   *  The index of one of the supported implementations,
+   *  for instance VoronoiThinner::ZHANG_SUEN_FAST.
+   *  \see implementation_id()
    * \param crop_img_before
    *  true to crop the image to its bounding box before thinning.
    *  Leads to a considerable speedup if the non-zero content of the image
@@ -100,31 +167,310 @@ public:
    *    NOLIMIT to let the implementation converge
    * \return
    *    true if success
-   *    false if \a implementation_name is not a supported implementation
+   *    false if \a implementation is not a supported implementation
+   */
+  inline bool thin(const cv::Mat1b & img,
+                   int implementation,
+                   bool crop_img_before = true,
+                   int max_iters = NOLIMIT) {
+    if (!check_implementation(implementation))
+      return false;
+    VORONOI_STATS(stats_begin(img.size()));
+    begin_thin(cv::Point(0, 0));
+    _step_implementation = -1;
+    bool success = registry()[implementation].fn(*this, img, crop_img_before, max_iters);
+    return end_thin(success, img.size());
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*!
+   * thin a given image with the implementation called \a implementation_name.
+   * To thin many images, it is faster to find once the index of the
+   * implementation with implementation_id().
+   * \see thin()
    */
   inline bool thin(const cv::Mat1b & img,
                    const std::string & implementation_name,
                    bool crop_img_before = true,
                    int max_iters = NOLIMIT) {
-    if (implementation_name == IMPL_MORPH)
-      return thin_morph(img, crop_img_before, max_iters);
-    else if (implementation_name == IMPL_ZHANG_SUEN_ORIGINAL)
-      return thin_zhang_suen_original(img, crop_img_before, max_iters);
-    else if (implementation_name == IMPL_ZHANG_SUEN)
-      return thin_zhang_suen(img, crop_img_before, max_iters);
-    else if (implementation_name == IMPL_ZHANG_SUEN_FAST)
-      return thin_zhang_suen_fast(img, crop_img_before, max_iters);
-    else if (implementation_name == IMPL_GUO_HALL_ORIGINAL)
-      return thin_guo_hall_original(img, crop_img_before, max_iters);
-    else if (implementation_name == IMPL_GUO_HALL)
-      return thin_guo_hall(img, crop_img_before, max_iters);
-    else if (implementation_name == IMPL_GUO_HALL_FAST)
-      return thin_guo_hall_fast(img, crop_img_before, max_iters);
-    else {
-      printf("Unknow implementation '%s', supported implementations: [%s]\n",
-             implementation_name.c_str(), all_implementations_as_string().c_str());
+    int implementation = implementation_id_or_warn(implementation_name);
+    if (implementation < 0)
+      return false;
+    return thin(img, implementation, crop_img_before, max_iters);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*!
+   * thin a mask given as runs of non zero pixels, without building the mask:
+   * only its bounding box is built, plus a border of one pixel.
+   * The contour-based implementations (ZHANG_SUEN_FAST and GUO_HALL_FAST)
+   * set the states of their contour directly from the ends of the runs,
+   * the other ones thin the bounding box.
+   * get_skeleton() and get_bbox() are the ones of thin() with crop_img_before.
+   * \param runs
+   *    sorted by row then by column, not overlapping, inside \a size.
+   *    The runs of a row may touch each other, \see ImageContour::from_runs().
+   * \param size
+   *    the size of the mask
+   * \see thin()
+   */
+  bool thin_runs(const std::vector<ImageContour::Run> & runs,
+                 const cv::Size & size,
+                 int implementation,
+                 int max_iters = NOLIMIT) {
+    if (!check_implementation(implementation))
+      return false;
+    VORONOI_STATS(stats_begin(size));
+    _step_implementation = -1;
+    cv::Rect bbox = runs_bounding_box(runs, size);
+    // add a border of one pixel
+    bbox = cv::Rect(bbox.x - 1, bbox.y - 1, bbox.width + 2, bbox.height + 2);
+    if (implementation == ZHANG_SUEN_FAST || implementation == GUO_HALL_FAST) {
+      begin_thin(cv::Point(0, 0));
+      _bbox = bbox;
+      skelcontour.from_runs(runs, _bbox);
+      bool success = (implementation == ZHANG_SUEN_FAST
+                      ? thin_fast_contour<ZhangSuenRule>(max_iters)
+                      : thin_fast_contour<GuoHallRule>(max_iters));
+      return end_thin(success, size);
+    }
+    // the part of the border inside the mask is built, the other one is virtual
+    bbox = bbox & cv::Rect(0, 0, size.width, size.height);
+    fit_workspace(runs_img, runs_img_buffer, bbox.size());
+    runs_img.setTo(0);
+    for (unsigned int run_idx = 0; run_idx < runs.size(); ++run_idx) {
+      const ImageContour::Run & run = runs[run_idx];
+      memset(runs_img.ptr<uchar>(run.row - bbox.y) + run.begin - bbox.x,
+             255, run.end - run.begin);
+    } // end loop run_idx
+    // the bounding box is thinned with its virtual border,
+    // then the results are moved to the coordinates of the mask
+    begin_thin(bbox.tl());
+    bool success = registry()[implementation].fn(*this, runs_img, false, max_iters);
+    return end_thin(success, bbox.size());
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*!
+   * thin an image stored in a buffer of the caller, without copying it.
+   * \param data  the first pixel of the image
+   * \param step  the number of bytes between the beginnings of two rows,
+   *              >= \a cols
+   * \see thin()
+   */
+  inline bool thin(const uchar* data, int rows, int cols, size_t step,
+                   int implementation,
+                   bool crop_img_before = true,
+                   int max_iters = NOLIMIT) {
+    const cv::Mat1b img(rows, cols, const_cast<uchar*>(data), step);
+    return thin(img, implementation, crop_img_before, max_iters);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*!
+   * thin \a img and replace its content with its skeleton:
+   * the pixels of the skeleton are set to 255, the other ones to 0.
+   * \a img can be a ROI or the header of a buffer of the caller.
+   * get_skeleton() and get_bbox() are set as with thin().
+   * \see thin()
+   */
+  inline bool thin_inplace(cv::Mat1b & img,
+                           int implementation,
+                           bool crop_img_before = true,
+                           int max_iters = NOLIMIT) {
+    if (!thin(img, implementation, crop_img_before, max_iters))
+      return false;
+    int xmin = _bbox.x, xmax = _bbox.x + _bbox.width;
+    for (int row = 0; row < img.rows; ++row) {
+      uchar* img_ptr = img.ptr<uchar>(row);
+      if (row < _bbox.y || row >= _bbox.y + _bbox.height) {
+        memset(img_ptr, 0, img.cols);
+        continue;
+      }
+      memset(img_ptr, 0, xmin);
+      memcpy(img_ptr + xmin, skel.ptr<uchar>(row - _bbox.y), _bbox.width);
+      memset(img_ptr + xmax, 0, img.cols - xmax);
+    } // end loop row
+    return true;
+  }
+
+  //! thin_inplace() with the implementation called \a implementation_name
+  inline bool thin_inplace(cv::Mat1b & img,
+                           const std::string & implementation_name,
+                           bool crop_img_before = true,
+                           int max_iters = NOLIMIT) {
+    int implementation = implementation_id_or_warn(implementation_name);
+    if (implementation < 0)
+      return false;
+    return thin_inplace(img, implementation, crop_img_before, max_iters);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*!
+   * start thinning \a img step by step, \see step() and current().
+   * The image is thresholded and cropped as with thin(),
+   * then the working images are kept between the steps:
+   * stepping until has_converged() costs the same as thin(),
+   * and gives the same skeleton.
+   * The implementations added with register_implementation() can not be
+   * resumed: they thin again a copy of \a img at each step.
+   * Calling thin() ends the step-wise thinning.
+   * \see thin() for the parameters
+   */
+  bool begin(const cv::Mat1b & img,
+             int implementation,
+             bool crop_img_before = true) {
+    _step_implementation = -1;
+    if (!check_implementation(implementation))
+      return false;
+    VORONOI_STATS(stats_begin(img.size()));
+    begin_thin(cv::Point(0, 0));
+    _step_crop = crop_img_before;
+    _step_size = img.size();
+    _step_niters = 0;
+    _step_finished = false;
+    _has_converged = false;
+    if (implementation >= NBUILTIN_IMPLEMENTATIONS) {
+      fit_workspace(step_img, step_img_buffer, img.size());
+      img.copyTo(step_img);
+    }
+    else
+      step_begin(implementation, img, crop_img_before);
+    _step_implementation = implementation;
+    return true;
+  }
+
+  //! begin() with the implementation called \a implementation_name
+  inline bool begin(const cv::Mat1b & img,
+                    const std::string & implementation_name,
+                    bool crop_img_before = true) {
+    int implementation = implementation_id_or_warn(implementation_name);
+    if (implementation < 0)
+      return false;
+    return begin(img, implementation, crop_img_before);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*!
+   * go on with the thinning started by begin(), for \a niters iterations
+   * or until it converges: an iteration is a pair of sub-iterations
+   * for Zhang-Suen and Guo-Hall, an erosion for the morphological one,
+   * the pixels at a distance in (n, n+1] for the distance-ordered one.
+   * \return false if begin() was not called
+   */
+  bool step(int niters = 1) {
+    if (_step_implementation < 0) {
+      printf("VoronoiThinner::step(): call begin() first\n");
       return false;
     }
+    if (_step_implementation >= NBUILTIN_IMPLEMENTATIONS) {
+      // thin again the copy of the image, with all the iterations
+      _step_niters = (niters >= NOLIMIT - _step_niters ? NOLIMIT : _step_niters + niters);
+      begin_thin(cv::Point(0, 0));
+      bool success = registry()[_step_implementation].fn
+          (*this, step_img, _step_crop, _step_niters);
+      _step_finished = true;
+      return end_thin(success, _step_size);
+    }
+    if (_step_finished)
+      step_resume();
+    for (int iter = 0; iter < niters && !_has_converged; ++iter) {
+      _has_converged = !step_iter(_step_implementation);
+      ++_step_niters;
+    } // end loop iter
+    return true;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*!
+   * \return the skeleton after the steps since begin(),
+   *  the image to thin before the first one.
+   *  get_skeleton(), get_bbox() and get_sparse_skeleton() are set as with thin().
+   *  The working images are not lost: the thinning can go on with step().
+   *  Like get_skeleton(), it is only valid until the next step().
+   */
+  const cv::Mat1b & current() {
+    if (_step_implementation < 0 || _step_finished)
+      return skel;
+    // the working images of skel are restored by step_resume()
+    _step_skel = skel;
+    _step_bbox = _bbox;
+    begin_thin(cv::Point(0, 0));
+    step_finish(_step_implementation);
+    VORONOI_STATS(stats_iterated());
+    end_thin(true, _step_size);
+    _step_finished = true;
+    return skel;
+  }
+
+  //! \return the number of iterations done by step() since begin()
+  inline int get_niters() const { return _step_niters; }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! add an implementation to the registry.
+   * Not thread-safe: the registry is read without any lock by thin()
+   * and implementation_id(), so it must not be called while other threads
+   * are thinning, for instance with a VoronoiSharedThinner.
+   * Register all the implementations before starting these threads.
+   * \return its index, to give to thin(),
+   *    -1 if there is already an implementation called \a implementation_name
+   */
+  static inline int register_implementation(const std::string & implementation_name,
+                                            ImplementationFn fn) {
+    if (implementation_id(implementation_name) >= 0)
+      return -1;
+    Implementation impl;
+    impl.name = implementation_name;
+    impl.fn = fn;
+    registry().push_back(impl);
+    return registry().size() - 1;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! \return the index of the implementation called \a implementation_name,
+   * -1 if there is none */
+  static inline int implementation_id(const std::string & implementation_name) {
+    const std::vector<Implementation> & impls = registry();
+    for (unsigned int impl_idx = 0; impl_idx < impls.size(); ++impl_idx) {
+      if (impls[impl_idx].name == implementation_name)
+        return impl_idx;
+    } // end loop impl_idx
+    return -1;
+  }
+
+  /*! implementation_id(), displaying the supported implementations
+   * if there is none called \a implementation_name */
+  static inline int implementation_id_or_warn(const std::string & implementation_name) {
+    int implementation = implementation_id(implementation_name);
+    if (implementation < 0)
+      printf("Unknow implementation '%s', supported implementations: [%s]\n",
+             implementation_name.c_str(), all_implementations_as_string().c_str());
+    return implementation;
+  }
+
+  //! \return the name of the implementation of index \a implementation
+  static inline std::string implementation_name(int implementation) {
+    return registry().at(implementation).name;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! set the results of thin(), for an implementation added with
+   * register_implementation(): the bounding box of the image
+   * that corresponds to get_skeleton(), and if it converged.
+   */
+  inline void set_results(const cv::Rect & bbox, bool has_converged) {
+    _bbox = bbox;
+    _has_converged = has_converged;
   }
 
   //////////////////////////////////////////////////////////////////////////////
@@ -138,12 +484,54 @@ public:
 
   /*! \return the current skeleton
    * Call thin() before accessing it.
-   * All non zero pixels correspond to the morphological skeleton of the image
+   * All non zero pixels correspond to the morphological skeleton of the image.
+   * It is a view of the working images of the thinner, that are reused:
+   * it is only valid until the next thin(), thin_runs() or begin(),
+   * which overwrite its pixels and can move them.
+   * A copy of the returned cv::Mat1b shares these pixels: clone() it to keep it.
    */
   inline const cv::Mat1b & get_skeleton() const {
     return skel;
   }
 
+  //! the skeleton, to be written by the implementations added with register_implementation()
+  inline cv::Mat1b & get_skeleton() {
+    return skel;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! \return the statistics of the last call to thin(),
+   * only computed if VORONOI_ENABLE_STATS is defined, \see ThinningStats.
+   * Add them with ThinningStats::operator+=() to aggregate several calls.
+   */
+  inline const ThinningStats & get_stats() const {
+    return _stats;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! set the sparse outputs computed by thin(), \see get_sparse_skeleton().
+   * \param outputs
+   *    a combination of SparseSkeleton::POINTS, SparseSkeleton::RUNS
+   *    and SparseSkeleton::CHAINS, SparseSkeleton::NONE (default) for none
+   */
+  inline void set_sparse_outputs(int outputs) {
+    _sparse.outputs = outputs;
+  }
+
+  //! \return the sparse outputs computed by thin(), \see set_sparse_outputs()
+  inline int get_sparse_outputs() const { return _sparse.outputs; }
+
+  /*! \return the pixels of the skeleton of the last call to thin(),
+   * in the coordinates of the image, as asked by set_sparse_outputs().
+   * The points and runs are gathered while the skeleton is written,
+   * without scanning it again.
+   */
+  inline const SparseSkeleton & get_sparse_skeleton() const {
+    return _sparse;
+  }
+
   //////////////////////////////////////////////////////////////////////////////
 
   /*! \return the bounding box used during thin().
@@ -158,25 +546,86 @@ public:
 
   //////////////////////////////////////////////////////////////////////////////
 
+  /*! \return the row kernel of \a implementation, for the given instructions,
+   * NULL if it is not a Zhang-Suen or a Guo-Hall implementation.
+   * The implementations of a family give the same skeleton.
+   * \param tables  set to the tables of its two sub-iterations
+   */
+  static inline RowKernels::RowFn row_kernel(int implementation,
+                                             RowKernels::Instructions instructions,
+                                             const uchar* tables[2]) {
+    switch (implementation) {
+      case ZHANG_SUEN:
+      case ZHANG_SUEN_ORIGINAL:
+      case ZHANG_SUEN_FAST:
+      case ZHANG_SUEN_BITBOARD:
+        tables[0] = zhang_suen_table(0);
+        tables[1] = zhang_suen_table(1);
+        return RowKernels::zhang_suen(instructions);
+      case GUO_HALL:
+      case GUO_HALL_ORIGINAL:
+      case GUO_HALL_FAST:
+      case GUO_HALL_BITBOARD:
+        tables[0] = guo_hall_table(0);
+        tables[1] = guo_hall_table(1);
+        return RowKernels::guo_hall(instructions);
+      default:
+        return NULL;
+    } // end switch (implementation)
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! set the instructions used by the row kernels of zhang_suen and guo_hall,
+   * and by the contour kernels of the fast implementations.
+   * By default, the most powerful ones supported by the CPU.
+   * RowKernels::SCALAR is the reference implementation.
+   * Instructions that the CPU does not support are replaced by the most
+   * powerful ones it supports, \see RowKernels::supported().
+   */
+  inline void set_instructions(RowKernels::Instructions instructions) {
+    _instructions = RowKernels::supported(instructions);
+    skelcontour.set_instructions(_instructions);
+  }
+
+  //! \return the instructions used by the row kernels
+  inline RowKernels::Instructions get_instructions() const { return _instructions; }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! set the number of threads used by zhang_suen, guo_hall,
+   * the bitboard implementations and the contour of the fast ones.
+   * Each sub-iteration is split in bands of rows, one per thread,
+   * the results being identical to the ones of a single thread.
+   * \param nthreads
+   *  1 (default) for no multi-threading,
+   *  <= 0 for the number of concurrent threads supported by the machine
+   */
+  inline void set_nthreads(int nthreads) {
+    if (nthreads <= 0)
+      nthreads = std::max(1u, std::thread::hardware_concurrency());
+    _nthreads = nthreads;
+    _pool.reset(nthreads > 1 ? new ThreadPool(nthreads) : NULL);
+  }
+
+  //! \return the number of threads used by thin()
+  inline int get_nthreads() const { return _nthreads; }
+
+  //////////////////////////////////////////////////////////////////////////////
+
   //! \return true if \arg implementation is among the existing ones
   static inline bool is_implementation_valid(const std::string & implementation) {
-    std::vector<std::string> impls = all_implementations();
-    return (std::find(impls.begin(), impls.end(), implementation)
-            != impls.end());
+    return (implementation_id(implementation) >= 0);
   }
 
   //////////////////////////////////////////////////////////////////////////////
 
   //! \return the list of all supported implementations
   static inline std::vector<std::string> all_implementations() {
+    const std::vector<Implementation> & impls = registry();
     std::vector<std::string> out;
-    out.push_back(IMPL_MORPH);
-    out.push_back(IMPL_GUO_HALL);
-    out.push_back(IMPL_GUO_HALL_ORIGINAL);
-    out.push_back(IMPL_GUO_HALL_FAST);
-    out.push_back(IMPL_ZHANG_SUEN);
-    out.push_back(IMPL_ZHANG_SUEN_ORIGINAL);
-    out.push_back(IMPL_ZHANG_SUEN_FAST);
+    for (unsigned int impl_idx = 0; impl_idx < impls.size(); ++impl_idx)
+      out.push_back(impls[impl_idx].name);
     return out;
   }
 
@@ -193,93 +642,242 @@ public:
 
   //////////////////////////////////////////////////////////////////////////////
 
-  /*! copy the non zero content of \a img to \a out
-   * and \return the ROI of img that was used
+  /*! copy the non zero content of \a img to \a out, with a border of one pixel,
+   * and \return the rectangle of \a img that corresponds to \a out.
+   * \a img can be any ROI, its rows are read with their step.
+   * Where the shapes touch the edges of \a img, the border is made of zeros
+   * and the rectangle goes one pixel out of \a img.
+   * \param crop_img_before
+   *    true to copy the bounding box of the non zero pixels,
+   *    false to copy the whole image
+   * \param out_buffer
+   *    if not NULL, \a out is a workspace on this memory, \see fit_workspace()
+   * \param instructions
+   *    the ones of the kernels finding the bounding box and copying the pixels
    */
   static inline cv::Rect copy_bounding_box_plusone(const cv::Mat1b& img,
                                                    cv::Mat1b& out,
-                                                   bool crop_img_before = true) {
-    // get the bounding box of the non-zero pixels of an image + a border of one pixel
-    if (!crop_img_before) {
-      img.copyTo(out);
-      return cv::Rect(0, 0, img.cols, img.rows);
+                                                   bool crop_img_before = true,
+                                                   std::vector<uchar>* out_buffer = NULL,
+                                                   RowKernels::Instructions instructions
+                                                   = RowKernels::best_instructions()) {
+    return bounding_box_plusone(img, out, crop_img_before, 0, false, out_buffer,
+                                instructions);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! copy_bounding_box_plusone() of the pixels of \a img > \a thresh,
+   * that are set to 1 in \a out, the other ones being set to 0.
+   * Thresholding and cropping are done in a single pass.
+   */
+  static inline cv::Rect threshold_bounding_box_plusone(const cv::Mat1b& img,
+                                                        cv::Mat1b& out,
+                                                        bool crop_img_before,
+                                                        uchar thresh,
+                                                        std::vector<uchar>* out_buffer = NULL,
+                                                        RowKernels::Instructions instructions
+                                                        = RowKernels::best_instructions()) {
+    return bounding_box_plusone(img, out, crop_img_before, thresh, true, out_buffer,
+                                instructions);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  //////////////////////////////////////////////////////////////////////////////
+
+protected:
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! the implementation of copy_bounding_box_plusone()
+   * and threshold_bounding_box_plusone().
+   * \param binarize  true to set the pixels > \a thresh to 1, false to copy them
+   */
+  static cv::Rect bounding_box_plusone(const cv::Mat1b& img,
+                                       cv::Mat1b& out,
+                                       bool crop_img_before,
+                                       uchar thresh,
+                                       bool binarize,
+                                       std::vector<uchar>* out_buffer,
+                                       RowKernels::Instructions instructions) {
+    instructions = RowKernels::supported(instructions);
+    cv::Rect bbox = bounding_box_full_img(img);
+    if (crop_img_before) {
+      cv::Rect content = threshold_bounding_box(img, thresh, instructions);
+      if (content.width > 0) // otherwise, empty image
+        bbox = content;
     }
-    cv::Rect bbox = boundingBox(img);
-    // printf("bbox:(%i, %i)+(%i, %i)\n", bbox.x, bbox.y, bbox.width, bbox.height);
+    // add a border of one pixel
     // the top and left boundary of the rectangle are inclusive,
     // while the right and bottom boundaries are not
-    if (bbox.x <= 0 || bbox.x + bbox.width >= img.cols
-        || bbox.y <= 0 || bbox.y + bbox.height >= img.rows) {
-      //  printf("img:(%i, %i), bbox:(%i, %i)+(%i, %i) "
-      //         " does not have a border of 1 pixel, "
-      //         "shrinking image.\n",
-      //         img.cols, img.rows, bbox.x, bbox.y, bbox.width, bbox.height);
-      out.create(img.size());
-      out.setTo(0);
-      cv::Mat1b out_roi = out(cv::Rect(1, 1, img.cols-2, img.rows-2));
-      cv::resize(img, out_roi, out_roi.size(), 0, 0, cv::INTER_NEAREST);
-      // img.copyTo(out(cv::Rect(1, 1, img.cols, img.rows)));
-      return cv::Rect(0, 0, img.cols, img.rows); // full bbox
-    }
-    // add a border of one pixel
     bbox.x --;
     bbox.y --;
     bbox.width += 2;
     bbox.height += 2;
     // printf("bbox:(%i, %i)+(%i, %i)\n", bbox.x, bbox.y, bbox.width, bbox.height);
-    img(bbox).copyTo(out);
+    if (out_buffer)
+      fit_workspace(out, *out_buffer, bbox.size());
+    else
+      out.create(bbox.size());
+    // the columns of the bounding box inside img
+    int xmin = std::max(bbox.x, 0), xmax = std::min(bbox.x + bbox.width, img.cols);
+    RowKernels::ThresholdRowFn threshold_row = RowKernels::threshold(instructions);
+    for (int row = 0; row < bbox.height; ++row) {
+      uchar* out_ptr = out.ptr<uchar>(row);
+      int img_row = bbox.y + row;
+      if (img_row < 0 || img_row >= img.rows || xmin >= xmax) { // virtual padding
+        memset(out_ptr, 0, bbox.width);
+        continue;
+      }
+      const uchar* img_ptr = img.ptr<uchar>(img_row);
+      uchar* out_it = out_ptr + (xmin - bbox.x);
+      memset(out_ptr, 0, xmin - bbox.x);
+      threshold_row(img_ptr + xmin, out_it, xmax - xmin, thresh, binarize);
+      memset(out_it + (xmax - xmin), 0, bbox.x + bbox.width - xmax);
+    } // end loop row
     return bbox;
-  } // end copy_bounding_box_plusone()
+  } // end bounding_box_plusone()
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! \return the bounding box of the pixels of \a img > \a thresh,
+   * cv::Rect(-1, -1, -1, -1) if there is none.
+   * \a img can be any ROI.
+   * The empty rows above and below the shapes are skipped a vector at a time,
+   * then only the columns out of the bounding box found so far are read.
+   */
+  static inline cv::Rect threshold_bounding_box(const cv::Mat1b & img, uchar thresh,
+                                                RowKernels::Instructions instructions
+                                                = RowKernels::best_instructions()) {
+    instructions = RowKernels::supported(instructions);
+    RowKernels::ScanFn first_above = RowKernels::first_above(instructions),
+        last_above = RowKernels::last_above(instructions);
+    int cols = img.cols, ymin = 0;
+    while (ymin < img.rows && first_above(img.ptr<uchar>(ymin), 0, cols, thresh) == cols)
+      ++ymin;
+    if (ymin == img.rows)
+      return cv::Rect(-1, -1, -1, -1);
+    int ymax = img.rows - 1; // the row ymin is not empty
+    while (last_above(img.ptr<uchar>(ymax), 0, cols, thresh) < 0)
+      --ymax;
+    const uchar* img_ptr = img.ptr<uchar>(ymin);
+    int xmin = first_above(img_ptr, 0, cols, thresh),
+        xmax = last_above(img_ptr, xmin, cols, thresh);
+    for (int row = ymin + 1; row <= ymax; ++row) {
+      img_ptr = img.ptr<uchar>(row);
+      xmin = first_above(img_ptr, 0, xmin, thresh);
+      xmax = last_above(img_ptr, xmax + 1, cols, thresh);
+    } // end loop row
+    return cv::Rect(xmin, ymin, 1 + xmax - xmin, 1 + ymax - ymin);
+  }
 
   //////////////////////////////////////////////////////////////////////////////
+
+  /*! \return true if \a implementation is the index of an implementation,
+   * otherwise display the supported ones */
+  static inline bool check_implementation(int implementation) {
+    if (implementation >= 0 && implementation < (int) registry().size())
+      return true;
+    printf("Unknow implementation %i, supported implementations: [%s]\n",
+           implementation, all_implementations_as_string().c_str());
+    return false;
+  }
+
   //////////////////////////////////////////////////////////////////////////////
 
-protected:
+  /*! prepare the outputs of an implementation,
+   * \param origin  the position in the thinned image of the one given
+   *                to the implementation */
+  inline void begin_thin(const cv::Point & origin) {
+    _origin = origin;
+    _sparse.clear();
+    _sparse_done = false;
+  }
+
+  /*! complete the outputs of an implementation that thinned an image
+   * of size \a size, and move them to the thinned image.
+   * \return \a success */
+  inline bool end_thin(bool success, const cv::Size & size) {
+    if (success) {
+      crop_skeleton_to_image(size);
+      if (_sparse.outputs)
+        finish_sparse_skeleton();
+      _bbox.x += _origin.x;
+      _bbox.y += _origin.y;
+    }
+    VORONOI_STATS(stats_end());
+    return success;
+  }
+
   //////////////////////////////////////////////////////////////////////////////
 
-  /*! From content_processing.h
- *\brief   get the bounding box of the non null points of an image
- *\param   img a monochrome image
- *\return the bounding box of the non null points,
- *        cv::Rect(-1, -1, -1, -1) if the image is empty
- */
-  template<class _T>
-  static inline cv::Rect boundingBox(const cv::Mat_<_T> & img) {
-    assert(img.isContinuous());
-    int xMin = 0, yMin = 0, xMax = 0, yMax = 0;
-    bool was_init = false;
-    const _T* img_it = img.ptr(0);
-    int nrows = img.rows, ncols = img.cols;
-    for (int y = 0; y < nrows; ++y) {
-      for (int x = 0; x < ncols; ++x) {
-        if (*img_it++) {
-          if (!was_init) {
-            xMin = xMax = x;
-            yMin = yMax = y;
-            was_init = true;
-            continue;
-          }
-          if (x < xMin)
-            xMin = x;
-          else if (x > xMax)
-            xMax = x;
-
-          if (y < yMin)
-            yMin = y;
-          else if (y > yMax)
-            yMax = y;
-        }
-      } // end loop x
-    } // end loop y
+  /*! \return the bounding box of \a runs,
+   * the whole mask of size \a size if there is none, as thin() */
+  static inline cv::Rect runs_bounding_box(const std::vector<ImageContour::Run> & runs,
+                                           const cv::Size & size) {
+    if (runs.empty())
+      return cv::Rect(0, 0, size.width, size.height);
+    int xmin = runs.front().begin, xmax = runs.front().end;
+    for (unsigned int run_idx = 1; run_idx < runs.size(); ++run_idx) {
+      xmin = std::min(xmin, runs[run_idx].begin);
+      xmax = std::max(xmax, runs[run_idx].end);
+    } // end loop run_idx
+    return cv::Rect(xmin, runs.front().row,
+                    xmax - xmin, 1 + runs.back().row - runs.front().row);
+  }
 
-    if (!was_init) // no white point found
-      return cv::Rect(-1, -1, -1, -1);
-    // from http://docs.opencv.org/java/org/opencv/core/Rect.html
-    // OpenCV typically assumes that the top and left boundary of the rectangle
-    // are inclusive, while the right and bottom boundaries are not.
-    // For example, the method Rect_.contains returns true if
-    // x <= pt.x < x+width,   y <= pt.y < y+height
-    return cv::Rect(xMin, yMin, 1 + xMax - xMin,  1 + yMax - yMin);
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! restrict the skeleton and the bounding box to an image of size \a size:
+   * the virtual border of bounding_box_plusone() is removed,
+   * skel becoming a ROI of its workspace.
+   */
+  inline void crop_skeleton_to_image(const cv::Size & size) {
+    cv::Rect inside = _bbox & cv::Rect(0, 0, size.width, size.height);
+    if (inside == _bbox)
+      return;
+    skel = skel(cv::Rect(inside.x - _bbox.x, inside.y - _bbox.y,
+                         inside.width, inside.height));
+    _bbox = inside;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! write in skel the final skeleton, the non zero pixels of \a src
+   * being set to 255, and gather its sparse outputs.
+   * \a src can be skel itself.
+   */
+  inline void finish_skeleton(const cv::Mat1b & src) {
+    if (src.data != skel.data)
+      fit_workspace(skel, skel_buffer, src.size());
+    int cols = src.cols;
+    for (int row = 0; row < src.rows; ++row) {
+      const uchar* src_ptr = src.ptr<uchar>(row);
+      uchar* skel_ptr = skel.ptr<uchar>(row);
+      for (int col = 0; col < cols; ++col)
+        skel_ptr[col] = (src_ptr[col] ? 255 : 0);
+      sparse_row(row);
+    } // end loop row
+    _sparse_done = true;
+  }
+
+  //! add the row \a row of skel to the sparse outputs, if any
+  inline void sparse_row(int row) {
+    if (_sparse.outputs)
+      _sparse.add_row(skel.ptr<uchar>(row), skel.cols,
+                      cv::Point(_origin.x + _bbox.x, _origin.y + _bbox.y + row));
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! the sparse outputs of an implementation that did not use
+   * finish_skeleton(), then the chains */
+  void finish_sparse_skeleton() {
+    if (!_sparse_done) {
+      for (int row = 0; row < skel.rows; ++row)
+        sparse_row(row);
+    }
+    if (_sparse.outputs & SparseSkeleton::CHAINS)
+      _sparse.build_chains(skel, _origin + _bbox.tl());
   }
 
   //////////////////////////////////////////////////////////////////////////////
@@ -291,38 +889,163 @@ protected:
 
   //////////////////////////////////////////////////////////////////////////////
 
-  //! from \link http://felix.abecassis.me/2011/09/opencv-morphological-skeleton/
+  /*! from \link http://felix.abecassis.me/2011/09/opencv-morphological-skeleton/
+   * Each iteration is a single sweep over the bounding box of the shape,
+   * that computes the erosion, the opening residue and the skeleton at once,
+   * \see morph_iter().
+   */
   bool thin_morph(const cv::Mat1b & img,
                   bool crop_img_before = true,
                   int max_iters = NOLIMIT) {
-    cv::threshold(img, temp, 10, 1, CV_THRESH_BINARY);
-    _bbox  = copy_bounding_box_plusone(temp, img_copy, crop_img_before);
-
-    skel.create(img_copy.size());
-    skel.setTo(0);
-    temp.create(img_copy.size());
-
+    begin_morph(img, crop_img_before);
     bool done = false;
     int niters = 0;
     while(!done) {
-      cv::erode(img_copy, eroded, element);
-      cv::dilate(eroded, dilated, element); // dilated = open(img)
-      cv::subtract(img_copy, dilated, temp);
-      cv::bitwise_or(skel, temp, skel);
-      eroded.copyTo(img_copy);
-      done = (cv::countNonZero(img_copy) == 0);
+      done = !morph_step();
       // cv::imshow("skel", skel); cv::waitKey(0);
       if ((niters++) >= max_iters) // must be at the end of the loop
         break;
     }
     //printf("niters:%i\n", niters);
-    cv::threshold(skel, skel, 0.5, 255, CV_THRESH_BINARY);
+    VORONOI_STATS(stats_iterated());
+    finish_skeleton(skel);
     _has_converged = done;
     return true;
   } // end from_img();
 
   //////////////////////////////////////////////////////////////////////////////
 
+  //! the preprocessing of thin_morph(), the skeleton being empty
+  void begin_morph(const cv::Mat1b & img, bool crop_img_before) {
+    _bbox  = threshold_bounding_box_plusone(img, img_copy, crop_img_before,
+                                            THRESHOLD, &img_copy_buffer, _instructions);
+    VORONOI_STATS(stats_preprocessed(img_copy));
+
+    fit_workspace(skel, skel_buffer, img_copy.size());
+    skel.setTo(0);
+    fit_workspace(eroded, eroded_buffer, img_copy.size());
+    morph_ones.assign(img_copy.cols, 1);
+    morph_zeros.assign(img_copy.cols, 0);
+    morph_window = threshold_bounding_box(img_copy, 0, _instructions);
+    morph_erode_fn = RowKernels::morph_erode(_instructions);
+    morph_residue_fn = RowKernels::morph_residue(_instructions);
+  }
+
+  //! one erosion of thin_morph(), \return false if nothing is left to erode
+  bool morph_step() {
+    VORONOI_STATS(stats_subiter(morph_window.width > 0 ? morph_window.area() : 0, -1));
+    morph_window = morph_iter(morph_window);
+    std::swap(img_copy, eroded);
+    img_copy_buffer.swap(eroded_buffer);
+    return (morph_window.width > 0);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*!
+   * One iteration of the morphological skeleton, with a 3x3 cross:
+   * eroded = erode(img_copy) and skel |= img_copy - dilate(eroded).
+   * The rows of eroded are computed one row ahead of the ones of skel.
+   * As for cv::erode() and cv::dilate(), the outside of the image
+   * does not change the erosion and the dilation.
+   * \param window
+   *    the bounding box of the non-zero pixels of img_copy.
+   *    eroded is written in its neighbourhood of one pixel.
+   * \return the bounding box of the non-zero pixels of eroded,
+   *    with a width <= 0 if eroded is empty
+   */
+  cv::Rect morph_iter(const cv::Rect & window) {
+    int rows = img_copy.rows, cols = img_copy.cols;
+    if (window.width <= 0)
+      return cv::Rect(-1, -1, -1, -1);
+    cv::Rect around = cv::Rect(window.x - 1, window.y - 1,
+                               window.width + 2, window.height + 2)
+        & cv::Rect(0, 0, cols, rows);
+    int xmin = cols, xmax = -1, ymin = rows, ymax = -1;
+    int next_eroded_row = around.y;
+    for (int row = window.y; row < window.y + window.height; ++row) {
+      // erosion of the rows needed for the dilation of this one
+      for (; next_eroded_row <= std::min(row + 1, around.y + around.height - 1);
+           ++next_eroded_row) {
+        int first, last;
+        if (morph_erode_row(next_eroded_row, window, around, first, last)) {
+          xmin = std::min(xmin, first);
+          xmax = std::max(xmax, last);
+          ymin = std::min(ymin, next_eroded_row);
+          ymax = next_eroded_row;
+        }
+      } // end loop next_eroded_row
+      morph_residue_row(row, window);
+    } // end loop row
+    if (xmax < 0)
+      return cv::Rect(-1, -1, -1, -1);
+    return cv::Rect(xmin, ymin, 1 + xmax - xmin, 1 + ymax - ymin);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! write the row \a row of eroded for the columns of \a around,
+   * the pixels out of \a window being 0.
+   * The columns that are not on the edges of the image go through
+   * the erosion kernel of the instructions, \see RowKernels::morph_erode().
+   * \return true if it has non-zero pixels, in the columns [first, last]
+   */
+  bool morph_erode_row(int row, const cv::Rect & window, const cv::Rect & around,
+                       int & first, int & last) {
+    int rows = img_copy.rows, cols = img_copy.cols;
+    uchar* out = eroded.ptr<uchar>(row);
+    memset(out + around.x, 0, around.width);
+    if (row < window.y || row >= window.y + window.height)
+      return false;
+    const uchar* mid = img_copy.ptr<uchar>(row);
+    const uchar* up = (row > 0 ? img_copy.ptr<uchar>(row - 1) : &(morph_ones[0]));
+    const uchar* down = (row < rows - 1 ? img_copy.ptr<uchar>(row + 1) : &(morph_ones[0]));
+    int x0 = window.x, x1 = window.x + window.width;
+    uchar nonzero = 0;
+    // the first and last columns, the outside being 1
+    if (x0 == 0) {
+      out[0] = mid[0] & up[0] & down[0] & (cols > 1 ? mid[1] : 1);
+      nonzero |= out[0];
+    }
+    if (x1 == cols && cols > 1) {
+      out[cols - 1] = mid[cols - 1] & up[cols - 1] & down[cols - 1] & mid[cols - 2];
+      nonzero |= out[cols - 1];
+    }
+    int begin = std::max(x0, 1), end = std::min(x1, cols - 1);
+    if (begin < end && morph_erode_fn(up, mid, down, out, begin, end))
+      nonzero = 1;
+    if (!nonzero)
+      return false;
+    for (first = x0; !out[first]; ++first) {}
+    for (last = x1 - 1; !out[last]; --last) {}
+    return true;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! skel |= img_copy - dilate(eroded) for the row \a row and the columns of \a window,
+   * \see RowKernels::morph_residue() */
+  void morph_residue_row(int row, const cv::Rect & window) {
+    int rows = img_copy.rows, cols = img_copy.cols;
+    const uchar* in = img_copy.ptr<uchar>(row);
+    const uchar* mid = eroded.ptr<uchar>(row);
+    const uchar* up = (row > 0 ? eroded.ptr<uchar>(row - 1) : &(morph_zeros[0]));
+    const uchar* down = (row < rows - 1 ? eroded.ptr<uchar>(row + 1) : &(morph_zeros[0]));
+    uchar* out = skel.ptr<uchar>(row);
+    int x0 = window.x, x1 = window.x + window.width;
+    // the first and last columns, the outside being 0
+    if (x0 == 0)
+      out[0] |= in[0] & ~(mid[0] | up[0] | down[0] | (cols > 1 ? mid[1] : 0));
+    if (x1 == cols && cols > 1)
+      out[cols - 1] |= in[cols - 1] & ~(mid[cols - 1] | up[cols - 1] | down[cols - 1]
+                                         | mid[cols - 2]);
+    int begin = std::max(x0, 1), end = std::min(x1, cols - 1);
+    if (begin < end)
+      morph_residue_fn(in, up, mid, down, out, begin, end);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
   /**
    * Function for thinning the given binary image
    * From \link http://opencv-code.com/quick-tips/implementation-of-thinning-algorithm-in-opencv/
@@ -332,31 +1055,52 @@ protected:
   bool thin_zhang_suen_original(const cv::Mat& img,
                                 bool crop_img_before = true,
                                 int max_iters = NOLIMIT) {
-    // im /= 255;
-    cv::threshold(img, temp, 10, 1, CV_THRESH_BINARY);
-    _bbox  = copy_bounding_box_plusone(temp, skel, crop_img_before);
-
-    cv::Mat prev = cv::Mat::zeros(skel.size(), CV_8UC1);
-    cv::Mat diff;
-
+    begin_original(img, crop_img_before);
     int niters = 0;
+    bool haschanged;
     do {
-      thin_zhang_suen_original_iter(skel, 0);
-      thin_zhang_suen_original_iter(skel, 1);
-      cv::absdiff(skel, prev, diff);
-      skel.copyTo(prev);
+      haschanged = original_step(false);
       if ((niters++) >= max_iters) // must be at the end of the loop
         break;
     }
-    while (cv::countNonZero(diff) > 0);
+    while (haschanged);
 
-    skel *= 255;
+    VORONOI_STATS(stats_iterated());
+    finish_skeleton(skel);
     _has_converged = (niters < max_iters);
     return true;
   }
 
   //////////////////////////////////////////////////////////////////////////////
 
+  //! the preprocessing of thin_zhang_suen_original() and thin_guo_hall_original()
+  void begin_original(const cv::Mat1b& img, bool crop_img_before) {
+    _bbox  = threshold_bounding_box_plusone(img, skel, crop_img_before,
+                                            THRESHOLD, &skel_buffer, _instructions);
+    VORONOI_STATS(stats_preprocessed(skel));
+
+    fit_workspace(prev, prev_buffer, skel.size());
+    prev.setTo(0);
+    fit_workspace(diff, diff_buffer, skel.size());
+  }
+
+  //! one iteration of the original implementations, \return true if skel changed
+  bool original_step(bool guo_hall) {
+    if (guo_hall) {
+      thin_guo_hall_original_iter(skel, 0);
+      thin_guo_hall_original_iter(skel, 1);
+    }
+    else {
+      thin_zhang_suen_original_iter(skel, 0);
+      thin_zhang_suen_original_iter(skel, 1);
+    }
+    cv::absdiff(skel, prev, diff);
+    skel.copyTo(prev);
+    return (cv::countNonZero(diff) > 0);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
   /**
    * Function for thinning the given binary image
    * From \link http://opencv-code.com/quick-tips/implementation-of-thinning-algorithm-in-opencv/
@@ -368,32 +1112,44 @@ protected:
                        int max_iters = NOLIMIT) {
     //im /= 255;
     // marker values need to be 0 or 1 for multiplications of values to make sense
-    cv::threshold(img, temp, 10, 1, CV_THRESH_BINARY);
-    _bbox  = copy_bounding_box_plusone(temp, skel, crop_img_before);
-
+    begin_rows(img, crop_img_before);
 
     int niters = 0;
     while (true) {
-      bool haschanged1 = thin_zhang_suen_iter(skel, 0);
-      //printf("0\n"); skel *= 255; cv::imshow("skel", skel); cv::waitKey(0); skel /= 255;
-      bool haschanged2 = thin_zhang_suen_iter(skel, 1);
-      //printf("1\n"); skel *= 255; cv::imshow("skel", skel); cv::waitKey(0); skel /= 255;
-      if (!haschanged1 && !haschanged2)
+      if (!rows_step(false))
         break;
       if ((niters++) >= max_iters) // must be at the end of the loop
         break;
     }
-    skel *= 255;
+    VORONOI_STATS(stats_iterated());
+    finish_skeleton(skel);
     _has_converged = (niters < max_iters);
     return true;
   } // end thin_zhang_suen();
 
   //////////////////////////////////////////////////////////////////////////////
 
+  //! the preprocessing of thin_zhang_suen() and thin_guo_hall()
+  void begin_rows(const cv::Mat1b& img, bool crop_img_before) {
+    _bbox  = threshold_bounding_box_plusone(img, skel, crop_img_before,
+                                            THRESHOLD, &skel_buffer, _instructions);
+    VORONOI_STATS(stats_preprocessed(skel));
+    reset_active_rows(skel.rows);
+  }
+
+  //! one iteration of thin_zhang_suen() or thin_guo_hall(), \return true if skel changed
+  bool rows_step(bool guo_hall) {
+    bool haschanged1 = (guo_hall ? thin_guo_hall_iter(skel, 0) : thin_zhang_suen_iter(skel, 0));
+    bool haschanged2 = (guo_hall ? thin_guo_hall_iter(skel, 1) : thin_zhang_suen_iter(skel, 1));
+    return (haschanged1 || haschanged2);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
   inline bool thin_zhang_suen_fast(const cv::Mat1b& img,
                                    bool crop_img_before = true,
                                    int max_iters = NOLIMIT) {
-    return thin_fast_custom_voronoi_fn(img, need_set_zhang_suen, crop_img_before, max_iters);
+    return thin_fast_custom_voronoi_fn<ZhangSuenRule>(img, crop_img_before, max_iters);
   }
 
   //////////////////////////////////////////////////////////////////////////////
@@ -407,25 +1163,18 @@ protected:
   bool thin_guo_hall_original(const cv::Mat1b& img,
                               bool crop_img_before = true,
                               int max_iters = NOLIMIT) {
-    // skel /= 255;
-    cv::threshold(img, temp, 10, 1, CV_THRESH_BINARY);
-    _bbox  = copy_bounding_box_plusone(temp, skel, crop_img_before);
-
-    cv::Mat prev = cv::Mat::zeros(skel.size(), CV_8UC1);
-    cv::Mat diff;
-
+    begin_original(img, crop_img_before);
     int niters = 0;
+    bool haschanged;
     do {
-      thin_guo_hall_original_iter(skel, 0);
-      thin_guo_hall_original_iter(skel, 1);
-      cv::absdiff(skel, prev, diff);
-      skel.copyTo(prev);
+      haschanged = original_step(true);
       if ((niters++) >= max_iters) // must be at the end of the loop
         break;
     }
-    while (cv::countNonZero(diff) > 0);
+    while (haschanged);
 
-    skel *= 255;
+    VORONOI_STATS(stats_iterated());
+    finish_skeleton(skel);
     _has_converged = (niters < max_iters);
     return true;
   }
@@ -442,24 +1191,17 @@ protected:
                      bool crop_img_before = true,
                      int max_iters = NOLIMIT) {
     //im /= 255;
-    cv::threshold(img, temp, 10, 1, CV_THRESH_BINARY);
-    _bbox  = copy_bounding_box_plusone(temp, skel, crop_img_before);
+    begin_rows(img, crop_img_before);
 
     int niters = 0;
     while (true) {
-      bool haschanged1 = thin_guo_hall_iter(skel, 0);
-      // printf("0\n"); skel *= 255; cv::imshow("skel", skel); cv::waitKey(0); skel /= 255;
-      // std::cout << "iter0: skel:" << ImageContour::to_string(skel) << std::endl;
-
-      bool haschanged2 = thin_guo_hall_iter(skel, 1);
-      // printf("1\n"); skel *= 255; cv::imshow("skel", skel); cv::waitKey(0); skel /= 255;
-      // std::cout << "iter1: skel:" << ImageContour::to_string(skel) << std::endl;
-      if (!haschanged1 && !haschanged2)
+      if (!rows_step(true))
         break;
       if ((niters++) >= max_iters) // must be at the end of the loop
         break;
     }
-    skel *= 255;
+    VORONOI_STATS(stats_iterated());
+    finish_skeleton(skel);
     _has_converged = (niters < max_iters);
     return true;
   }
@@ -469,88 +1211,553 @@ protected:
   inline bool thin_guo_hall_fast(const cv::Mat1b& img,
                                  bool crop_img_before = true,
                                  int max_iters = NOLIMIT) {
-    return thin_fast_custom_voronoi_fn(img, need_set_guo_hall, crop_img_before, max_iters);
+    return thin_fast_custom_voronoi_fn<GuoHallRule>(img, crop_img_before, max_iters);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*!
+   * Zhang-Suen or Guo-Hall on a bit-packed image:
+   * each row is stored in 64-bit words, one bit per pixel,
+   * and the rule is evaluated for 64 pixels at once with boolean algebra
+   * on the shifted words of the neighbours.
+   * Gives the same skeletons as thin_zhang_suen() and thin_guo_hall().
+   */
+  bool thin_bitboard(const cv::Mat1b& img,
+                     bool guo_hall,
+                     bool crop_img_before = true,
+                     int max_iters = NOLIMIT) {
+    begin_bitboard(img, crop_img_before);
+    int niters = 0;
+    while (true) {
+      if (!bitboard_step(guo_hall))
+        break;
+      if ((niters++) >= max_iters) // must be at the end of the loop
+        break;
+    }
+    VORONOI_STATS(stats_iterated());
+    finish_bitboard();
+    _has_converged = (niters < max_iters);
+    return true;
+  } // end thin_bitboard();
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! the preprocessing of thin_bitboard(): skel is packed into bitboard
+  void begin_bitboard(const cv::Mat1b& img, bool crop_img_before) {
+    _bbox  = threshold_bounding_box_plusone(img, skel, crop_img_before,
+                                            THRESHOLD, &skel_buffer, _instructions);
+    VORONOI_STATS(stats_preprocessed(skel));
+
+    // pack skel
+    int cols = skel.cols, rows = skel.rows;
+    bitboard_words = (cols + 63) / 64;
+    bitboard.assign(rows * bitboard_words, 0);
+    for (int row = 0; row < rows; ++row) {
+      const uchar* skel_ptr = skel.ptr<uchar>(row);
+      uint64_t* words = &(bitboard[row * bitboard_words]);
+      for (int col = 0; col < cols; ++col) {
+        if (skel_ptr[col])
+          words[col >> 6] |= (uint64_t) 1 << (col & 63);
+      } // end loop col
+    } // end loop row
+    bitboard_next = bitboard;
+    // only the pixels that are not on the border of the image can be set to 0
+    bitboard_interior.assign(bitboard_words, 0);
+    for (int col = 1; col < cols - 1; ++col)
+      bitboard_interior[col >> 6] |= (uint64_t) 1 << (col & 63);
+  }
+
+  //! one iteration of thin_bitboard(), \return true if a pixel was set to 0
+  bool bitboard_step(bool guo_hall) {
+    bool haschanged1 = thin_bitboard_iter(guo_hall, 0);
+    bool haschanged2 = thin_bitboard_iter(guo_hall, 1);
+    return (haschanged1 || haschanged2);
+  }
+
+  //! unpack bitboard into skel, as the final skeleton
+  void finish_bitboard() {
+    int cols = skel.cols, rows = skel.rows;
+    for (int row = 0; row < rows; ++row) {
+      uchar* skel_ptr = skel.ptr<uchar>(row);
+      const uint64_t* words = &(bitboard[row * bitboard_words]);
+      for (int col = 0; col < cols; ++col)
+        skel_ptr[col] = ((words[col >> 6] >> (col & 63)) & 1 ? 255 : 0);
+      sparse_row(row);
+    } // end loop row
+    _sparse_done = true;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*!
+   * Perform one thinning iteration on the bit-packed image,
+   * from bitboard to bitboard_next, then swap them.
+   * \return true if a pixel was set to 0
+   */
+  bool thin_bitboard_iter(bool guo_hall, int iter) {
+    int rows = bitboard.size() / bitboard_words, nbands = get_nbands(rows);
+    VORONOI_STATS(stats_subiter(rows * bitboard_words * 64, -1));
+    band_changed.assign(nbands, 0);
+    if (nbands == 1)
+      thin_bitboard_band(guo_hall, iter, 0, 1);
+    else
+      _pool->parallel_for(nbands, [this, guo_hall, iter, nbands](int band, int) {
+        thin_bitboard_band(guo_hall, iter, band, nbands);
+      });
+    // the first and last rows are never written and equal in both boards
+    std::swap(bitboard, bitboard_next);
+    for (int band = 0; band < nbands; ++band) {
+      if (band_changed[band])
+        return true;
+    } // end loop band
+    return false;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! thin_bitboard_iter() for the rows of band \a band among \a nbands
+  void thin_bitboard_band(bool guo_hall, int iter, int band, int nbands) {
+    uint64_t haschanged = 0;
+    int nwords = bitboard_words, rows = bitboard.size() / bitboard_words;
+    int first = std::max(1, band * rows / nbands),
+        last = std::min(rows - 1, (band + 1) * rows / nbands);
+    for (int row = first; row < last; ++row) {
+      const uint64_t *up = &(bitboard[(row-1) * nwords]),
+          *mid = up + nwords, *down = mid + nwords;
+      uint64_t* out = &(bitboard_next[row * nwords]);
+      for (int w = 0; w < nwords; ++w) {
+        // a pixel of the west (resp. east) word is the left (resp. right)
+        // neighbour of the pixel with the same bit in the current word
+        uint64_t
+            p1 = mid[w],
+            p2 = up[w],
+            p3 = east_word(up, w, nwords),
+            p4 = east_word(mid, w, nwords),
+            p5 = east_word(down, w, nwords),
+            p6 = down[w],
+            p7 = west_word(down, w),
+            p8 = west_word(mid, w),
+            p9 = west_word(up, w);
+        uint64_t del = p1 & bitboard_interior[w] & (guo_hall ?
+            guo_hall_word(p2, p3, p4, p5, p6, p7, p8, p9, iter) :
+            zhang_suen_word(p2, p3, p4, p5, p6, p7, p8, p9, iter));
+        out[w] = p1 & ~del;
+        haschanged |= del;
+      } // end loop w
+    } // end loop row
+    band_changed[band] = (haschanged != 0);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! \return the word of the left neighbours of the pixels of words[w]
+  static inline uint64_t west_word(const uint64_t* words, int w) {
+    return (words[w] << 1) | (w ? words[w-1] >> 63 : 0);
+  }
+
+  //! \return the word of the right neighbours of the pixels of words[w]
+  static inline uint64_t east_word(const uint64_t* words, int w, int nwords) {
+    return (words[w] >> 1) | (w + 1 < nwords ? words[w+1] << 63 : 0);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! \return the bits of the pixels that zhang_suen_rule() sets to 0
+  static inline uint64_t zhang_suen_word(uint64_t p2, uint64_t p3, uint64_t p4,
+                                         uint64_t p5, uint64_t p6, uint64_t p7,
+                                         uint64_t p8, uint64_t p9, int iter) {
+    // A == 1: exactly one 0 -> 1 transition
+    uint64_t t[8] = {~p2 & p3, ~p3 & p4, ~p4 & p5, ~p5 & p6,
+                     ~p6 & p7, ~p7 & p8, ~p8 & p9, ~p9 & p2};
+    uint64_t one = 0, two = 0;
+    for (int i = 0; i < 8; ++i) {
+      two |= one & t[i];
+      one |= t[i];
+    }
+    // B = p2 + ... + p9 as 4 bit planes, with full adders
+    uint64_t sa = p2 ^ p3 ^ p4, ca = (p2 & p3) | (p4 & (p2 ^ p3));
+    uint64_t sb = p5 ^ p6 ^ p7, cb = (p5 & p6) | (p7 & (p5 ^ p6));
+    uint64_t sc = p8 ^ p9,      cc = p8 & p9;
+    uint64_t b0 = sa ^ sb ^ sc, c1 = (sa & sb) | (sc & (sa ^ sb));
+    uint64_t st = ca ^ cb ^ cc, u = (ca & cb) | (cc & (ca ^ cb));
+    uint64_t b1 = st ^ c1, v = st & c1;
+    uint64_t b2 = u ^ v, b3 = u & v;
+    uint64_t B_ok = (b3 | b2 | b1) // B >= 2
+        & ~(b3 | (b2 & b1 & b0)); // B <= 6
+    uint64_t m1 = (iter == 0 ? (p2 & p4 & p6) : (p2 & p4 & p8));
+    uint64_t m2 = (iter == 0 ? (p4 & p6 & p8) : (p2 & p6 & p8));
+    return one & ~two & B_ok & ~m1 & ~m2;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! \return the bits of the pixels that guo_hall_rule() sets to 0
+  static inline uint64_t guo_hall_word(uint64_t p2, uint64_t p3, uint64_t p4,
+                                       uint64_t p5, uint64_t p6, uint64_t p7,
+                                       uint64_t p8, uint64_t p9, int iter) {
+    // C == 1
+    uint64_t c[4] = {~p2 & (p3 | p4), ~p4 & (p5 | p6),
+                     ~p6 & (p7 | p8), ~p8 & (p9 | p2)};
+    uint64_t one = 0, two = 0;
+    for (int i = 0; i < 4; ++i) {
+      two |= one & c[i];
+      one |= c[i];
+    }
+    // 2 <= N <= 3, with N = min(N1, N2)
+    uint64_t a1 = p9 | p2, a2 = p3 | p4, a3 = p5 | p6, a4 = p7 | p8;
+    uint64_t b1 = p2 | p3, b2 = p4 | p5, b3 = p6 | p7, b4 = p8 | p9;
+    uint64_t N1_ge2 = (a1 & a2) | (a3 & a4) | ((a1 | a2) & (a3 | a4));
+    uint64_t N2_ge2 = (b1 & b2) | (b3 & b4) | ((b1 | b2) & (b3 | b4));
+    uint64_t N_eq4 = a1 & a2 & a3 & a4 & b1 & b2 & b3 & b4;
+    uint64_t m  = iter == 0 ? ((p6 | p7 | ~p9) & p8) : ((p2 | p3 | ~p5) & p4);
+    return one & ~two & N1_ge2 & N2_ge2 & ~N_eq4 & ~m;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*!
+   * Thin the image in a number of passes that does not depend on its thickness:
+   * the exact Euclidean distance transform of the shape is computed,
+   * and its ridge pixels, the local maxima of the distance, are kept as anchors
+   * that are never set to 0, \see is_ridge_anchor().
+   * The other pixels are visited by increasing distance to the background,
+   * and the simple ones that are not the end of a line are set to 0.
+   * A last pass over the remaining pixels removes the ones
+   * that became simple after their visit.
+   * An iteration corresponds to the pixels at a distance in (n, n+1].
+   */
+  bool thin_distance_transform(const cv::Mat1b& img,
+                               bool crop_img_before = true,
+                               int max_iters = NOLIMIT) {
+    begin_distance_transform(img, crop_img_before);
+    distance_transform_until((int64_t) max_iters + 1);
+    VORONOI_STATS(stats_iterated());
+    finish_distance_transform();
+    return true;
+  } // end thin_distance_transform();
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! the preprocessing of thin_distance_transform():
+   * the pixels of skel that are not ridge anchors are sorted by distance in dt_order */
+  void begin_distance_transform(const cv::Mat1b& img, bool crop_img_before) {
+    _bbox  = threshold_bounding_box_plusone(img, skel, crop_img_before,
+                                            THRESHOLD, &skel_buffer, _instructions);
+    VORONOI_STATS(stats_preprocessed(skel));
+    assert(skel.isContinuous());
+    int cols = skel.cols, rows = skel.rows;
+    distance_transform_squared(skel);
+
+    // the local maxima of the distance, among the 4 neighbours
+    dt_ridge.assign(rows * cols, 0);
+    for (int row = 1; row < rows - 1; ++row)
+      for (int col = 1; col < cols - 1; ++col) {
+        int key = row * cols + col, dist2 = dt_dist2[key];
+        dt_ridge[key] = (dist2 > 0
+                         && dist2 >= dt_dist2[key - 1] && dist2 >= dt_dist2[key + 1]
+                         && dist2 >= dt_dist2[key - cols] && dist2 >= dt_dist2[key + cols]);
+      } // end loop col
+
+    // sort the pixels that can be set to 0 by distance, with a counting sort
+    int max_dist2 = 0;
+    for (int key = 0; key < rows * cols; ++key)
+      max_dist2 = std::max(max_dist2, dt_dist2[key]);
+    dt_bucket_start.assign(max_dist2 + 2, 0);
+    for (int row = 1; row < rows - 1; ++row)
+      for (int col = 1; col < cols - 1; ++col) {
+        int key = row * cols + col;
+        if (!is_ridge_anchor(key, cols))
+          ++dt_bucket_start[dt_dist2[key] + 1];
+      } // end loop col
+    for (int dist2 = 1; dist2 <= max_dist2 + 1; ++dist2)
+      dt_bucket_start[dist2] += dt_bucket_start[dist2 - 1];
+    dt_order.resize(dt_bucket_start[max_dist2 + 1]);
+    for (int row = 1; row < rows - 1; ++row)
+      for (int col = 1; col < cols - 1; ++col) {
+        int key = row * cols + col;
+        if (!is_ridge_anchor(key, cols))
+          dt_order[dt_bucket_start[dt_dist2[key]]++] = key;
+      } // end loop col
+    // the background pixels are at the beginning
+    dt_next = dt_bucket_start[0];
+    dt_niters = 0;
+    dt_survivors.clear();
+    dt_survivors_done = false;
+  }
+
+  /*! \return true if the pixel \a key (row * cols + col) is a ridge anchor
+   * of thin_distance_transform(): a local maximum of the distance (dt_ridge),
+   * that is not the second pixel of a ridge two pixels thick.
+   * These ones, for instance in the middle of a bar of even width,
+   * are equal local maxima below or on the right of another one,
+   * without one on the other side.
+   */
+  inline bool is_ridge_anchor(int key, int cols) const {
+    if (!dt_ridge[key])
+      return false;
+    int dist2 = dt_dist2[key];
+    bool up = dt_ridge[key - cols] && dt_dist2[key - cols] == dist2,
+        down = dt_ridge[key + cols] && dt_dist2[key + cols] == dist2,
+        left = dt_ridge[key - 1] && dt_dist2[key - 1] == dist2,
+        right = dt_ridge[key + 1] && dt_dist2[key + 1] == dist2;
+    return !(up && !down) && !(left && !right);
+  }
+
+  /*! set to 0 the simple pixels of dt_order at a distance <= \a max_dist,
+   * by increasing distance, from dt_next.
+   * \return true if some pixels are left */
+  bool distance_transform_until(int64_t max_dist) {
+    uchar* skeldata = skel.data;
+    int cols = skel.cols;
+    const uchar* table = simple_point_table();
+    VORONOI_STATS(unsigned int first = dt_next);
+    for (; dt_next < dt_order.size(); ++dt_next) {
+      int key = dt_order[dt_next];
+      if (dt_dist2[key] > max_dist * max_dist)
+        break;
+      if (table[neighbourhood_index(skeldata, key, cols)])
+        skeldata[key] = 0;
+      else
+        dt_survivors.push_back(key);
+    } // end loop dt_next
+    VORONOI_STATS(stats_subiter(dt_next - first, -1));
+    return (dt_next < dt_order.size());
+  }
+
+  //! one iteration of thin_distance_transform(), \return true if some pixels are left
+  inline bool distance_transform_step() {
+    return distance_transform_until(++dt_niters);
+  }
+
+  /*! once all pixels are visited, set to 0 the ones that became simple
+   * after their visit, then write the final skeleton */
+  void finish_distance_transform() {
+    _has_converged = (dt_next == dt_order.size());
+    if (_has_converged && !dt_survivors_done) {
+      uchar* skeldata = skel.data;
+      int cols = skel.cols;
+      const uchar* table = simple_point_table();
+      for (unsigned int surv_idx = 0; surv_idx < dt_survivors.size(); ++surv_idx) {
+        int key = dt_survivors[surv_idx];
+        if (table[neighbourhood_index(skeldata, key, cols)])
+          skeldata[key] = 0;
+      } // end loop surv_idx
+      VORONOI_STATS(_stats.npixels_visited += dt_survivors.size());
+      dt_survivors_done = true;
+    }
+    finish_skeleton(skel);
   }
 
   //////////////////////////////////////////////////////////////////////////////
 
-  //! \return true if skel needs to be set to 0
-  typedef bool (*VoronoiFn)(uchar*  skeldata, int iter, int col, int row, int cols);
+  /*!
+   * The exact squared Euclidean distance of each pixel of \a im to the nearest
+   * 0 pixel, the outside of the image being 0, stored in dt_dist2.
+   * It is computed with 64-bit integers, and stored clamped to INT_MAX.
+   * From 'A general algorithm for computing distance transforms in linear time'
+   * by A. Meijster, J. Roerdink and W. Hesselink.
+   */
+  void distance_transform_squared(const cv::Mat1b& im) {
+    int cols = im.cols, rows = im.rows;
+    // first phase: distance to the nearest 0 pixel of the column
+    dt_column.resize(rows * cols);
+    const uchar* imdata = im.data;
+    int* g = &(dt_column[0]);
+    for (int col = 0; col < cols; ++col)
+      g[col] = (imdata[col] ? 1 : 0);
+    for (int row = 1; row < rows; ++row) {
+      for (int col = 0; col < cols; ++col) {
+        int key = row * cols + col;
+        g[key] = (imdata[key] ? g[key - cols] + 1 : 0);
+      } // end loop col
+    } // end loop row
+    for (int key = (rows - 1) * cols; key < rows * cols; ++key)
+      g[key] = std::min(g[key], 1);
+    for (int row = rows - 2; row >= 0; --row) {
+      for (int col = 0; col < cols; ++col) {
+        int key = row * cols + col;
+        g[key] = std::min(g[key], g[key + cols] + 1);
+      } // end loop col
+    } // end loop row
+
+    // second phase: lower envelope of the parabolas of each row
+    dt_dist2.resize(rows * cols);
+    dt_sites.resize(cols);
+    dt_starts.resize(cols);
+    int *s = &(dt_sites[0]), *t = &(dt_starts[0]);
+    for (int row = 0; row < rows; ++row) {
+      const int* grow = g + row * cols;
+      int* dist2 = &(dt_dist2[row * cols]);
+      int q = 0;
+      s[0] = t[0] = 0;
+      for (int u = 1; u < cols; ++u) {
+        while (q >= 0 && edt_f(t[q], s[q], grow) > edt_f(t[q], u, grow))
+          --q;
+        if (q < 0) {
+          q = 0;
+          s[0] = u;
+        }
+        else {
+          int64_t w = 1 + edt_sep(s[q], u, grow);
+          if (w < cols) {
+            ++q;
+            s[q] = u;
+            t[q] = (int) w;
+          }
+        }
+      } // end loop u
+      for (int u = cols - 1; u >= 0; --u) {
+        // the outside of the image, on the left and on the right
+        int border = std::min(u + 1, cols - u);
+        dist2[u] = std::min(std::min(edt_f(u, s[q], grow), (int64_t) border * border),
+                            (int64_t) INT_MAX);
+        if (u == t[q])
+          --q;
+      } // end loop u
+    } // end loop row
+  } // end distance_transform_squared()
+
+  //! the parabola of site \a i at column \a x
+  static inline int64_t edt_f(int x, int i, const int* g) {
+    int64_t dx = x - i, gi = g[i];
+    return dx * dx + gi * gi;
+  }
+
+  //! the first column where the parabola of site \a u is below the one of site \a i < \a u, minus one
+  static inline int64_t edt_sep(int i, int u, const int* g) {
+    int64_t gi = g[i], gu = g[u];
+    int64_t num = (int64_t) u * u - (int64_t) i * i + gu * gu - gi * gi, den = 2 * (u - i);
+    return (num >= 0 ? num / den : -((-num + den - 1) / den)); // floor
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
 
+  /*! The contour worklist thinning, specialised for each algorithm.
+   * \param Rule
+   *    a functor built from the sub-iteration, whose
+   *    operator()(skeldata, key, cols) \return true if the pixel \a key
+   *    (row * cols + col) needs to be set to 0, \see ZhangSuenRule
+   */
+  template<class Rule>
   bool thin_fast_custom_voronoi_fn(const cv::Mat1b& img,
-                                   VoronoiFn voronoi_fn,
                                    bool crop_img_before = true,
                                    int max_iters = NOLIMIT) {
     //  printf("thin_fast_custom_voronoi_fn(crop_img_before:%i, max_iters:%i)\n",
     //         crop_img_before, max_iters);
-    _bbox  = copy_bounding_box_plusone(img, skel, crop_img_before);
-    skelcontour.from_image_C4(skel);
-    // printf("skelcontour:'%s'\n", skelcontour.to_string().c_str());
-    int cols = skelcontour.cols, rows = skelcontour.rows;
+    _bbox  = threshold_bounding_box_plusone(img, skel, crop_img_before,
+                                            THRESHOLD, &skel_buffer, _instructions);
+    skelcontour.from_image_C4(skel, _pool.get());
+    return thin_fast_contour<Rule>(max_iters);
+  } // end thin_fast_custom_voronoi_fn();
 
-    // clear queues
-    uchar * skelcontour_data = skelcontour.data;
+  //////////////////////////////////////////////////////////////////////////////
 
+  /*! the iterations of thin_fast_custom_voronoi_fn(),
+   * skelcontour and _bbox being already set */
+  template<class Rule>
+  bool thin_fast_contour(int max_iters) {
+    // printf("skelcontour:'%s'\n", skelcontour.to_string().c_str());
+    begin_fast_contour();
     int niters = 0;
     bool change_made = true;
     while (change_made && niters < max_iters) {
       //printf("loop\n");
       change_made = false;
       for (unsigned short iter = 0; iter < 2; ++iter) {
-        //printf("loop iter\n");
-        uchar *skelcontour_ptr = skelcontour_data;
-        rows_to_set.clear();
-        cols_to_set.clear();
-        // for each point in skelcontour, check if it needs to be changed
-        for (int row = 0; row < rows; ++row) {
-          for (int col = 0; col < cols; ++col) {
-            //printf("Checking (%i, %i)...\n", col, row);
-            if (*skelcontour_ptr++ == ImageContour::CONTOUR &&
-                voronoi_fn(skelcontour_data, iter, col, row, cols)) {
-              //printf("(%i, %i) is to be removed\n", col, row);
-              cols_to_set.push_back(col);
-              rows_to_set.push_back(row);
-            }
-          } // end for (col)
-        } // end for (row)
-
-        // set all points in rows_to_set (of skel)
-        unsigned int rows_to_set_size = rows_to_set.size();
-        for (unsigned int pt_idx = 0; pt_idx < rows_to_set_size; ++pt_idx) {
-          if (!change_made)
-            change_made = (skelcontour(rows_to_set[pt_idx], cols_to_set[pt_idx]));
-          skelcontour.set_point_empty_C4(rows_to_set[pt_idx], cols_to_set[pt_idx]);
-        } // end for (pt_idx)
-
-#if 0 // debug info
-        //std::cout << "skel:" << std::endl << skel << std::endl;
-        printf("iter:%i, rows_to_set.size():%i\n", iter, rows_to_set.size());
-        printf("iter:%i, skelcontour.contour_size():%i\n", iter, skelcontour.contour_size());
-        printf("iter:%i, skelcontour:%s\n", iter, skelcontour.to_string().c_str());
-        cv::imshow("skelcontour", skelcontour);
-        cv::waitKey(0);
-#endif
+        if (fast_contour_subiter<Rule>(iter))
+          change_made = true;
         if ((niters++) >= max_iters) // must be at the end of the loop
           break;
       } // end for (iter)
     } // end while (true)
 
-    skel = (skelcontour != ImageContour::EMPTY);
+    VORONOI_STATS(stats_iterated());
+    finish_skeleton(skelcontour);
     _has_converged = !change_made;
     return true;
-  } // end thin_fast_custom_voronoi_fn();
+  } // end thin_fast_contour();
 
   //////////////////////////////////////////////////////////////////////////////
 
-  static bool inline need_set_zhang_suen(uchar*  skeldata, int iter, int col, int row, int cols) {
-    bool p2 = skeldata[(row-1) * cols + col];
-    bool p3 = skeldata[(row-1) * cols + col+1];
-    bool p4 = skeldata[row     * cols + col+1];
-    bool p5 = skeldata[(row+1) * cols + col+1];
-    bool p6 = skeldata[(row+1) * cols + col];
-    bool p7 = skeldata[(row+1) * cols + col-1];
-    bool p8 = skeldata[row     * cols + col-1];
-    bool p9 = skeldata[(row-1) * cols + col-1];
+  //! the worklist of thin_fast_contour(): only the current contour pixels are examined
+  inline void begin_fast_contour() {
+    skelcontour.contour_keys(contour);
+    VORONOI_STATS(stats_preprocessed(skelcontour));
+  }
+
+  //! one iteration of thin_fast_contour(), \return true if a pixel was set to 0
+  template<class Rule>
+  inline bool fast_contour_step() {
+    bool haschanged1 = fast_contour_subiter<Rule>(0);
+    bool haschanged2 = fast_contour_subiter<Rule>(1);
+    return (haschanged1 || haschanged2);
+  }
+
+  /*! the sub-iteration \a iter of thin_fast_contour() on the contour,
+   * \return true if a pixel was set to 0 */
+  template<class Rule>
+  bool fast_contour_subiter(int iter) {
+    int cols = skelcontour.cols;
+    uchar * skelcontour_data = skelcontour.data;
+    //printf("loop iter\n");
+    keys_to_set.clear();
+    next_contour.clear();
+    const Rule need_set(iter);
+    VORONOI_STATS(stats_subiter(contour.size(), contour.size()));
+    // for each point in the contour, check if it needs to be changed
+    unsigned int contour_size = contour.size();
+    for (unsigned int pt_idx = 0; pt_idx < contour_size; ++pt_idx) {
+      int key = contour[pt_idx];
+      //printf("Checking %i...\n", key);
+      if (need_set(skelcontour_data, key, cols)) {
+        //printf("%i is to be removed\n", key);
+        keys_to_set.push_back(key);
+      }
+      else // stays in the contour
+        next_contour.push_back(key);
+    } // end for (pt_idx)
+
+    // set all points in keys_to_set (of skel),
+    // the inner points they expose make the contour of next sub-iteration
+    unsigned int keys_to_set_size = keys_to_set.size();
+    for (unsigned int pt_idx = 0; pt_idx < keys_to_set_size; ++pt_idx) {
+      int key = keys_to_set[pt_idx], row = key / cols;
+      skelcontour.set_point_empty_C4(row, key - row * cols, next_contour);
+    } // end for (pt_idx)
+    contour.swap(next_contour);
+
+#if 0 // debug info
+    //std::cout << "skel:" << std::endl << skel << std::endl;
+    printf("iter:%i, keys_to_set.size():%i\n", iter, keys_to_set.size());
+    printf("iter:%i, contour.size():%i\n", iter, contour.size());
+    printf("iter:%i, skelcontour:%s\n", iter, skelcontour.to_string().c_str());
+    cv::imshow("skelcontour", skelcontour);
+    cv::waitKey(0);
+#endif
+    return (keys_to_set_size > 0);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! \return the 9-bit index of the neighbourhood of \a key (row * cols + col)
+   * \see RowKernels::column_bits() for the layout of the index
+   */
+  static inline int neighbourhood_index(const uchar* data, int key, int cols) {
+    const uchar* mid = data + key;
+    return RowKernels::column_bits(mid - cols, mid, mid + cols, -1)
+        | (RowKernels::column_bits(mid - cols, mid, mid + cols, 0) << 3)
+        | (RowKernels::column_bits(mid - cols, mid, mid + cols, 1) << 6);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! \return true if the pixel p1 of neighbourhood \a idx needs to be set to 0
+  static constexpr bool zhang_suen_rule(int idx, int iter) {
+    bool p1 = (idx >> 4) & 1,
+        p2 = (idx >> 3) & 1, p3 = (idx >> 6) & 1, p4 = (idx >> 7) & 1,
+        p5 = (idx >> 8) & 1, p6 = (idx >> 5) & 1, p7 = (idx >> 2) & 1,
+        p8 = (idx >> 1) & 1, p9 = idx & 1;
     int A  = (!p2 && p3) + (!p3 && p4) +
              (!p4 && p5) + (!p5 && p6) +
              (!p6 && p7) + (!p7 && p8) +
@@ -558,31 +1765,210 @@ protected:
     int B  = p2 + p3 + p4 + p5 + p6 + p7 + p8 + p9;
     int m1 = (iter == 0 ? (p2 * p4 * p6) : (p2 * p4 * p8));
     int m2 = (iter == 0 ? (p4 * p6 * p8) : (p2 * p6 * p8));
-    return (A == 1 && (B >= 2 && B <= 6) && !m1 && !m2);
+    return (p1 && A == 1 && (B >= 2 && B <= 6) && !m1 && !m2);
   }
 
   //////////////////////////////////////////////////////////////////////////////
 
-  static bool inline need_set_guo_hall(uchar*  skeldata, int iter, int col, int row, int cols) {
-    //uchar
-    bool
-        p2 = skeldata[(row-1) * cols + col],
-        p3 = skeldata[(row-1) * cols + col+1],
-        p4 = skeldata[row     * cols + col+1],
-        p5 = skeldata[(row+1) * cols + col+1],
-        p6 = skeldata[(row+1) * cols + col],
-        p7 = skeldata[(row+1) * cols + col-1],
-        p8 = skeldata[row     * cols + col-1],
-        p9 = skeldata[(row-1) * cols + col-1];
-
+  //! \return true if the pixel p1 of neighbourhood \a idx needs to be set to 0
+  static constexpr bool guo_hall_rule(int idx, int iter) {
+    bool p1 = (idx >> 4) & 1,
+        p2 = (idx >> 3) & 1, p3 = (idx >> 6) & 1, p4 = (idx >> 7) & 1,
+        p5 = (idx >> 8) & 1, p6 = (idx >> 5) & 1, p7 = (idx >> 2) & 1,
+        p8 = (idx >> 1) & 1, p9 = idx & 1;
     int C  = (!p2 & (p3 | p4)) + (!p4 & (p5 | p6)) +
              (!p6 & (p7 | p8)) + (!p8 & (p9 | p2));
     int N1 = (p9 | p2) + (p3 | p4) + (p5 | p6) + (p7 | p8);
     int N2 = (p2 | p3) + (p4 | p5) + (p6 | p7) + (p8 | p9);
     int N  = N1 < N2 ? N1 : N2;
     int m  = iter == 0 ? ((p6 | p7 | !p9) & p8) : ((p2 | p3 | !p5) & p4);
+    return (p1 && C == 1 && (N >= 2 && N <= 3) && m == 0);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! the rule of an algorithm for every neighbourhood index and sub-iteration
+  struct NeighbourhoodTable {
+    uchar need_set[2][512];
+    constexpr NeighbourhoodTable(bool guo_hall) : need_set() {
+      for (int iter = 0; iter < 2; ++iter)
+        for (int idx = 0; idx < 512; ++idx)
+          need_set[iter][idx] = (guo_hall ? guo_hall_rule(idx, iter)
+                                          : zhang_suen_rule(idx, iter));
+    }
+  }; // end struct NeighbourhoodTable
+
+  //! \return the table of Zhang-Suen for sub-iteration \a iter, built at compile time
+  static inline const uchar* zhang_suen_table(int iter) {
+    static constexpr NeighbourhoodTable table(false);
+    return table.need_set[iter];
+  }
+
+  //! \return the table of Guo-Hall for sub-iteration \a iter, built at compile time
+  static inline const uchar* guo_hall_table(int iter) {
+    static constexpr NeighbourhoodTable table(true);
+    return table.need_set[iter];
+  }
+
+  /*! \return true if the pixel p1 of neighbourhood \a idx is simple,
+   * i.e. setting it to 0 keeps the 8-connected components of the shape
+   * and the 4-connected ones of the background, and is not the end of a line.
+   * A pixel is simple if its 8-connectivity number, by Yokoi, is 1.
+   */
+  static constexpr bool simple_point_rule(int idx) {
+    bool p1 = (idx >> 4) & 1,
+        p2 = (idx >> 3) & 1, p3 = (idx >> 6) & 1, p4 = (idx >> 7) & 1,
+        p5 = (idx >> 8) & 1, p6 = (idx >> 5) & 1, p7 = (idx >> 2) & 1,
+        p8 = (idx >> 1) & 1, p9 = idx & 1;
+    // the complements of the neighbours, counter-clockwise from the right one
+    bool x1 = !p4, x2 = !p3, x3 = !p2, x4 = !p9,
+        x5 = !p8, x6 = !p7, x7 = !p6, x8 = !p5;
+    int N8 = (x1 && !(x2 && x3)) + (x3 && !(x4 && x5))
+        + (x5 && !(x6 && x7)) + (x7 && !(x8 && x1));
+    int B  = p2 + p3 + p4 + p5 + p6 + p7 + p8 + p9;
+    return (p1 && N8 == 1 && B >= 2);
+  }
+
+  //! simple_point_rule() for every neighbourhood index
+  struct SimplePointTable {
+    uchar need_set[512];
+    constexpr SimplePointTable() : need_set() {
+      for (int idx = 0; idx < 512; ++idx)
+        need_set[idx] = simple_point_rule(idx);
+    }
+  }; // end struct SimplePointTable
+
+  //! \return the table of simple_point_rule(), built at compile time
+  static inline const uchar* simple_point_table() {
+    static constexpr SimplePointTable table;
+    return table.need_set;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! the rule of Zhang-Suen for a sub-iteration of thin_fast_custom_voronoi_fn()
+  struct ZhangSuenRule {
+    explicit ZhangSuenRule(int iter) : table(zhang_suen_table(iter)) {}
+    inline bool operator()(const uchar* skeldata, int key, int cols) const {
+      return table[neighbourhood_index(skeldata, key, cols)];
+    }
+    const uchar* table;
+  }; // end struct ZhangSuenRule
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! the rule of Guo-Hall for a sub-iteration of thin_fast_custom_voronoi_fn()
+  struct GuoHallRule {
+    explicit GuoHallRule(int iter) : table(guo_hall_table(iter)) {}
+    inline bool operator()(const uchar* skeldata, int key, int cols) const {
+      return table[neighbourhood_index(skeldata, key, cols)];
+    }
+    const uchar* table;
+  }; // end struct GuoHallRule
+
+  //////////////////////////////////////////////////////////////////////////////
 
-    return (C == 1 && (N >= 2 && N <= 3) && m == 0);
+  /*!
+   * Perform one thinning iteration of an algorithm, row by row,
+   * with the kernel of the instructions set by set_instructions().
+   *
+   * \param  im     Binary image with range = 0-1, skel
+   * \param  row_fn the row kernel of the algorithm
+   * \param  iter   0=even, 1=odd
+   * \param  table  the table of the algorithm for \a iter
+   * \return true if a pixel was set to 0
+   */
+  bool thin_rows_iter(cv::Mat1b& im, RowKernels::RowFn row_fn,
+                      int iter, const uchar* table) {
+    assert(im.isContinuous());
+    assert(im.data == skel.data);
+    int rows = im.rows;
+    if ((int) rows_changed.size() != rows)
+      reset_active_rows(rows);
+    // a row is examined if it or one of its neighbours changed
+    // in one of the last two sub-iterations:
+    // otherwise the rule of this sub-iteration did not delete anything
+    // in the same neighbourhood the last time it was applied
+    int nactive = 0;
+    for (int row = 1; row < rows - 1; ++row) {
+      rows_active[row] = rows_changed[row - 1] | rows_changed[row]
+          | rows_changed[row + 1] | rows_changed_prev[row - 1]
+          | rows_changed_prev[row] | rows_changed_prev[row + 1];
+      nactive += rows_active[row];
+    } // end loop row
+    VORONOI_STATS(stats_subiter((long) nactive * std::max(0, im.cols - 2), -1));
+    rows_changed_prev.swap(rows_changed);
+    fit_workspace(temp, temp_buffer, im.size());
+    int nbands = get_nbands(rows);
+    band_changed.assign(nbands, 0);
+    if (nbands == 1)
+      thin_rows_band(im, row_fn, iter, table, 0, 1);
+    else
+      _pool->parallel_for(nbands, [&](int band, int) {
+        thin_rows_band(im, row_fn, iter, table, band, nbands);
+      });
+    std::swap(im, temp);
+    skel_buffer.swap(temp_buffer);
+    rows_synced = true;
+    for (int band = 0; band < nbands; ++band) {
+      if (band_changed[band])
+        return true;
+    } // end loop band
+    return false;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! thin_rows_iter() for the rows of band \a band among \a nbands:
+   * they are copied from \a im to temp, then thinned in temp.
+   * The rows of \a im around the band are the halo of the band,
+   * they are only read.
+   * Once temp is synchronized, only the active rows are copied and thinned:
+   * the other ones did not change since temp was \a im.
+   */
+  void thin_rows_band(const cv::Mat1b& im, RowKernels::RowFn row_fn,
+                      int iter, const uchar* table, int band, int nbands) {
+    bool haschanged = false;
+    const uchar*  imdata = im.data;
+    uchar*  tempdata = temp.data;
+    int cols = im.cols, rows = im.rows;
+    int first = band * rows / nbands, last = (band + 1) * rows / nbands;
+    if (!rows_synced)
+      memcpy(tempdata + first * cols, imdata + first * cols, (last - first) * cols);
+    for (int row = first; row < last; row++) {
+      rows_changed[row] = 0;
+      if (row == 0 || row == rows - 1 || !rows_active[row])
+        continue;
+      const uchar *up = imdata + (row-1) * cols;
+      uchar* out = tempdata + row * cols;
+      if (rows_synced)
+        memcpy(out, up + cols, cols);
+      if (row_fn(up, up + cols, up + 2 * cols, out, cols, iter, table)) {
+        rows_changed[row] = 1;
+        haschanged = true;
+      }
+    } // end loop row
+    band_changed[band] = haschanged;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! mark all the rows of an image of \a rows rows as active,
+   * before the first sub-iteration of thin_rows_iter() on a new image */
+  void reset_active_rows(int rows) {
+    rows_changed.assign(rows, 1);
+    rows_changed_prev.assign(rows, 1);
+    rows_active.assign(rows, 0);
+    rows_synced = false;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! \return the number of bands of rows for an image of \a rows rows
+  inline int get_nbands(int rows) const {
+    if (!_pool)
+      return 1;
+    return std::max(1, std::min(_pool->size(), rows / MIN_BAND_ROWS));
   }
 
   //////////////////////////////////////////////////////////////////////////////
@@ -596,35 +1982,21 @@ protected:
    */
   void thin_zhang_suen_original_iter(cv::Mat& im, int iter)
   {
-    cv::Mat marker = cv::Mat::zeros(im.size(), CV_8UC1);
+    fit_workspace(marker, marker_buffer, im.size());
+    marker.setTo(0);
+    VORONOI_STATS(stats_subiter(std::max(0, (im.rows - 2) * (im.cols - 2)), -1));
+    const uchar* table = zhang_suen_table(iter);
 
     for (int i = 1; i < im.rows-1; i++)
     {
       for (int j = 1; j < im.cols-1; j++)
       {
-        uchar p2 = im.at<uchar>(i-1, j);
-        uchar p3 = im.at<uchar>(i-1, j+1);
-        uchar p4 = im.at<uchar>(i, j+1);
-        uchar p5 = im.at<uchar>(i+1, j+1);
-        uchar p6 = im.at<uchar>(i+1, j);
-        uchar p7 = im.at<uchar>(i+1, j-1);
-        uchar p8 = im.at<uchar>(i, j-1);
-        uchar p9 = im.at<uchar>(i-1, j-1);
-
-        int A  = (p2 == 0 && p3 == 1) + (p3 == 0 && p4 == 1) +
-                 (p4 == 0 && p5 == 1) + (p5 == 0 && p6 == 1) +
-                 (p6 == 0 && p7 == 1) + (p7 == 0 && p8 == 1) +
-                 (p8 == 0 && p9 == 1) + (p9 == 0 && p2 == 1);
-        int B  = p2 + p3 + p4 + p5 + p6 + p7 + p8 + p9;
-        int m1 = iter == 0 ? (p2 * p4 * p6) : (p2 * p4 * p8);
-        int m2 = iter == 0 ? (p4 * p6 * p8) : (p2 * p6 * p8);
-
-        if (A == 1 && (B >= 2 && B <= 6) && m1 == 0 && m2 == 0)
+        if (table[neighbourhood_index(im.ptr<uchar>(0), i * im.cols + j, im.cols)])
           marker.at<uchar>(i,j) = 1;
       }
     }
 
-    im &= ~marker;
+    im.setTo(0, marker);
   }
 
   //////////////////////////////////////////////////////////////////////////////
@@ -636,46 +2008,9 @@ protected:
    * \param  im    Binary image with range = 0-1
    * \param  iter  0=even, 1=odd
    */
-  bool thin_zhang_suen_iter(cv::Mat1b& im, int iter) {
-    bool haschanged = false;
-    assert(im.isContinuous());
-    uchar*  imdata = im.data;
-    im.copyTo(temp);
-    assert(temp.isContinuous());
-    uchar*  tempdata = temp.data;
-    unsigned int cols = im.cols, colmax = im.cols -1, rowmax = im.rows - 1;
-    for (unsigned int row = 1; row < rowmax; row++) {
-      for (unsigned int col = 1; col < colmax; col++) {
-#if 0
-        bool p2 = imdata[(row-1) * cols + col];
-        bool p3 = imdata[(row-1) * cols + col+1];
-        bool p4 = imdata[row     * cols + col+1];
-        bool p5 = imdata[(row+1) * cols + col+1];
-        bool p6 = imdata[(row+1) * cols + col];
-        bool p7 = imdata[(row+1) * cols + col-1];
-        bool p8 = imdata[row     * cols + col-1];
-        bool p9 = imdata[(row-1) * cols + col-1];
-        int A  = (!p2 && p3) + (!p3 && p4) +
-                 (!p4 && p5) + (!p5 && p6) +
-                 (!p6 && p7) + (!p7 && p8) +
-                 (!p8 && p9) + (!p9 && p2);
-        int B  = p2 + p3 + p4 + p5 + p6 + p7 + p8 + p9;
-        int m1 = (iter == 0 ? (p2 * p4 * p6) : (p2 * p4 * p8));
-        int m2 = (iter == 0 ? (p4 * p6 * p8) : (p2 * p6 * p8));
-
-        if (A == 1 && (B >= 2 && B <= 6) && !m1 && !m2) {
-#else
-        if (need_set_zhang_suen(imdata, iter, col, row, cols)) {
-#endif
-          if (!haschanged)
-            haschanged = (tempdata[row * cols +col] != 0);
-          tempdata[row * cols +col] = 0;
-        }
-      } // end loop col
-    } // end loop row
-
-    std::swap(im, temp);
-    return haschanged;
+  inline bool thin_zhang_suen_iter(cv::Mat1b& im, int iter) {
+    return thin_rows_iter(im, RowKernels::zhang_suen(_instructions),
+                          iter, zhang_suen_table(iter));
   }
 
   //////////////////////////////////////////////////////////////////////////////
@@ -687,46 +2022,9 @@ protected:
    * \param  im    Binary image with range = 0-1
    * \param  iter  0=even, 1=odd
    */
-  bool thin_guo_hall_iter(cv::Mat1b& im, int iter) {
-    bool haschanged = false;
-    assert(im.isContinuous());
-    uchar*  imdata = im.data;
-    im.copyTo(temp);
-    assert(temp.isContinuous());
-    uchar*  tempdata = temp.data;
-    unsigned int cols = im.cols, colmax = im.cols -1, rowmax = im.rows - 1;
-    for (unsigned int row = 1; row < rowmax; row++) {
-      for (unsigned int col = 1; col < colmax; col++) {
-#if 0
-        uchar p2 = imdata[(row-1) * cols + col];
-        uchar p3 = imdata[(row-1) * cols + col+1];
-        uchar p4 = imdata[row     * cols + col+1];
-        uchar p5 = imdata[(row+1) * cols + col+1];
-        uchar p6 = imdata[(row+1) * cols + col];
-        uchar p7 = imdata[(row+1) * cols + col-1];
-        uchar p8 = imdata[row     * cols + col-1];
-        uchar p9 = imdata[(row-1) * cols + col-1];
-
-        int C  = (!p2 & (p3 | p4)) + (!p4 & (p5 | p6)) +
-                 (!p6 & (p7 | p8)) + (!p8 & (p9 | p2));
-        int N1 = (p9 | p2) + (p3 | p4) + (p5 | p6) + (p7 | p8);
-        int N2 = (p2 | p3) + (p4 | p5) + (p6 | p7) + (p8 | p9);
-        int N  = N1 < N2 ? N1 : N2;
-        int m  = iter == 0 ? ((p6 | p7 | !p9) & p8) : ((p2 | p3 | !p5) & p4);
-
-        if (C == 1 && (N >= 2 && N <= 3) && m == 0) {
-#else
-        if (need_set_guo_hall(imdata, iter, col, row, cols)) {
-#endif
-          if (!haschanged)
-            haschanged = (tempdata[row * cols +col] != 0);
-          tempdata[row * cols +col] = 0;
-        }
-      } // end loop col
-    } // end loop row
-
-    std::swap(im, temp);
-    return haschanged;
+  inline bool thin_guo_hall_iter(cv::Mat1b& im, int iter) {
+    return thin_rows_iter(im, RowKernels::guo_hall(_instructions),
+                          iter, guo_hall_table(iter));
   }
 
   //////////////////////////////////////////////////////////////////////////////
@@ -740,57 +2038,319 @@ protected:
    * \param  iter  0=even, 1=odd
    */
   void thin_guo_hall_original_iter(cv::Mat& im, int iter) {
-    cv::Mat marker = cv::Mat::zeros(im.size(), CV_8UC1);
-    unsigned int colmax = im.cols -1, rowmax = im.rows - 1;
+    fit_workspace(marker, marker_buffer, im.size());
+    marker.setTo(0);
+    VORONOI_STATS(stats_subiter(std::max(0, (im.rows - 2) * (im.cols - 2)), -1));
+    const uchar* table = guo_hall_table(iter);
+    int colmax = im.cols -1, rowmax = im.rows - 1;
     for (int i = 1; i < rowmax; i++)
     {
       for (int j = 1; j < colmax; j++)
       {
-        uchar p2 = im.at<uchar>(i-1, j);
-        uchar p3 = im.at<uchar>(i-1, j+1);
-        uchar p4 = im.at<uchar>(i, j+1);
-        uchar p5 = im.at<uchar>(i+1, j+1);
-        uchar p6 = im.at<uchar>(i+1, j);
-        uchar p7 = im.at<uchar>(i+1, j-1);
-        uchar p8 = im.at<uchar>(i, j-1);
-        uchar p9 = im.at<uchar>(i-1, j-1);
-
-        int C  = (!p2 & (p3 | p4)) + (!p4 & (p5 | p6)) +
-                 (!p6 & (p7 | p8)) + (!p8 & (p9 | p2));
-        int N1 = (p9 | p2) + (p3 | p4) + (p5 | p6) + (p7 | p8);
-        int N2 = (p2 | p3) + (p4 | p5) + (p6 | p7) + (p8 | p9);
-        int N  = N1 < N2 ? N1 : N2;
-        int m  = iter == 0 ? ((p6 | p7 | !p9) & p8) : ((p2 | p3 | !p5) & p4);
-
-        if (C == 1 && (N >= 2 && N <= 3) && m == 0)
+        if (table[neighbourhood_index(im.ptr<uchar>(0), i * im.cols + j, im.cols)])
           marker.at<uchar>(i,j) = 1;
       }
     }
 
-    im &= ~marker;
+    im.setTo(0, marker);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  // step-wise thinning of the built-in implementations, \see begin()
+
+  //! the preprocessing of the built-in implementation \a implementation
+  void step_begin(int implementation, const cv::Mat1b & img, bool crop_img_before) {
+    switch (implementation) {
+      case MORPH:
+        begin_morph(img, crop_img_before);
+        break;
+      case GUO_HALL:
+      case ZHANG_SUEN:
+        begin_rows(img, crop_img_before);
+        break;
+      case GUO_HALL_ORIGINAL:
+      case ZHANG_SUEN_ORIGINAL:
+        begin_original(img, crop_img_before);
+        break;
+      case GUO_HALL_FAST:
+      case ZHANG_SUEN_FAST:
+        _bbox = threshold_bounding_box_plusone(img, skel, crop_img_before,
+                                               THRESHOLD, &skel_buffer, _instructions);
+        skelcontour.from_image_C4(skel, _pool.get());
+        begin_fast_contour();
+        break;
+      case GUO_HALL_BITBOARD:
+      case ZHANG_SUEN_BITBOARD:
+        begin_bitboard(img, crop_img_before);
+        break;
+      case DISTANCE_TRANSFORM:
+      default:
+        begin_distance_transform(img, crop_img_before);
+        break;
+    } // end switch (implementation)
+  }
+
+  //! one iteration of \a implementation, \return true if the image changed
+  bool step_iter(int implementation) {
+    switch (implementation) {
+      case MORPH:               return morph_step();
+      case GUO_HALL:            return rows_step(true);
+      case ZHANG_SUEN:          return rows_step(false);
+      case GUO_HALL_ORIGINAL:   return original_step(true);
+      case ZHANG_SUEN_ORIGINAL: return original_step(false);
+      case GUO_HALL_FAST:       return fast_contour_step<GuoHallRule>();
+      case ZHANG_SUEN_FAST:     return fast_contour_step<ZhangSuenRule>();
+      case GUO_HALL_BITBOARD:   return bitboard_step(true);
+      case ZHANG_SUEN_BITBOARD: return bitboard_step(false);
+      case DISTANCE_TRANSFORM:
+      default:                  return distance_transform_step();
+    } // end switch (implementation)
+  }
+
+  //! write the skeleton of the working images of \a implementation in skel
+  void step_finish(int implementation) {
+    switch (implementation) {
+      case GUO_HALL_FAST:
+      case ZHANG_SUEN_FAST:
+        finish_skeleton(skelcontour);
+        break;
+      case GUO_HALL_BITBOARD:
+      case ZHANG_SUEN_BITBOARD:
+        finish_bitboard();
+        break;
+      case DISTANCE_TRANSFORM:
+        finish_distance_transform();
+        break;
+      default:
+        finish_skeleton(skel);
+        break;
+    } // end switch (implementation)
+  }
+
+  /*! undo current(): skel and _bbox become the working ones again,
+   * the pixels of skel being 0 or 1 */
+  void step_resume() {
+    skel = _step_skel;
+    _bbox = _step_bbox;
+    for (int row = 0; row < skel.rows; ++row) {
+      uchar* skel_ptr = skel.ptr<uchar>(row);
+      for (int col = 0; col < skel.cols; ++col)
+        skel_ptr[col] = (skel_ptr[col] ? 1 : 0);
+    } // end loop row
+    _step_finished = false;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  // statistics, only used if VORONOI_ENABLE_STATS is defined
+
+  //! \return the milliseconds since the previous lap, and start a new one
+  inline double stats_lap_ms() {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::milli> elapsed = now - _stats_time;
+    _stats_time = now;
+    return elapsed.count();
+  }
+
+  //! start the statistics of thin(img)
+  inline void stats_begin(const cv::Size & size) {
+    _stats.reset();
+    _stats.ncalls = 1;
+    _stats.input_area = size.area();
+    _stats_npixels_before = -1;
+    _stats_time = std::chrono::steady_clock::now();
+  }
+
+  //! the preprocessing is over, \a im is the image to thin
+  inline void stats_preprocessed(const cv::Mat1b & im) {
+    _stats.preprocessing_ms = stats_lap_ms();
+    _stats_npixels_before = cv::countNonZero(im);
+    _stats_time = std::chrono::steady_clock::now();
+  }
+
+  /*! a sub-iteration examining \a npixels_visited pixels,
+   * \a contour_size the size of the contour, or -1 if there is none */
+  inline void stats_subiter(long npixels_visited, long contour_size) {
+    ++_stats.niters;
+    _stats.npixels_visited += npixels_visited;
+    if (contour_size >= 0)
+      _stats.contour_sizes.push_back(contour_size);
+  }
+
+  //! the iterations are over, the skeleton will be converted
+  inline void stats_iterated() {
+    _stats.iterations_ms = stats_lap_ms();
+  }
+
+  //! the skeleton is ready
+  inline void stats_end() {
+    _stats.output_ms = stats_lap_ms();
+    _stats.bbox_area = _bbox.area();
+    if (_stats_npixels_before >= 0)
+      _stats.npixels_deleted = _stats_npixels_before - cv::countNonZero(skel);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  struct Implementation {
+    std::string name;
+    ImplementationFn fn;
+  };
+
+  //! \return the implementations, indexed by their id
+  static std::vector<Implementation> & registry() {
+    static std::vector<Implementation> impls = builtin_implementations();
+    return impls;
+  }
+
+  //! \return the built-in implementations, in the order of ImplementationId
+  static std::vector<Implementation> builtin_implementations() {
+    std::vector<Implementation> impls(NBUILTIN_IMPLEMENTATIONS);
+    impls[MORPH].name = IMPL_MORPH;
+    impls[MORPH].fn = [](VoronoiThinner & thinner, const cv::Mat1b & img,
+                         bool crop_img_before, int max_iters) {
+      return thinner.thin_morph(img, crop_img_before, max_iters);
+    };
+    impls[GUO_HALL].name = IMPL_GUO_HALL;
+    impls[GUO_HALL].fn = [](VoronoiThinner & thinner, const cv::Mat1b & img,
+                            bool crop_img_before, int max_iters) {
+      return thinner.thin_guo_hall(img, crop_img_before, max_iters);
+    };
+    impls[GUO_HALL_ORIGINAL].name = IMPL_GUO_HALL_ORIGINAL;
+    impls[GUO_HALL_ORIGINAL].fn = [](VoronoiThinner & thinner, const cv::Mat1b & img,
+                                     bool crop_img_before, int max_iters) {
+      return thinner.thin_guo_hall_original(img, crop_img_before, max_iters);
+    };
+    impls[GUO_HALL_FAST].name = IMPL_GUO_HALL_FAST;
+    impls[GUO_HALL_FAST].fn = [](VoronoiThinner & thinner, const cv::Mat1b & img,
+                                 bool crop_img_before, int max_iters) {
+      return thinner.thin_guo_hall_fast(img, crop_img_before, max_iters);
+    };
+    impls[GUO_HALL_BITBOARD].name = IMPL_GUO_HALL_BITBOARD;
+    impls[GUO_HALL_BITBOARD].fn = [](VoronoiThinner & thinner, const cv::Mat1b & img,
+                                     bool crop_img_before, int max_iters) {
+      return thinner.thin_bitboard(img, true, crop_img_before, max_iters);
+    };
+    impls[ZHANG_SUEN].name = IMPL_ZHANG_SUEN;
+    impls[ZHANG_SUEN].fn = [](VoronoiThinner & thinner, const cv::Mat1b & img,
+                              bool crop_img_before, int max_iters) {
+      return thinner.thin_zhang_suen(img, crop_img_before, max_iters);
+    };
+    impls[ZHANG_SUEN_ORIGINAL].name = IMPL_ZHANG_SUEN_ORIGINAL;
+    impls[ZHANG_SUEN_ORIGINAL].fn = [](VoronoiThinner & thinner, const cv::Mat1b & img,
+                                       bool crop_img_before, int max_iters) {
+      return thinner.thin_zhang_suen_original(img, crop_img_before, max_iters);
+    };
+    impls[ZHANG_SUEN_FAST].name = IMPL_ZHANG_SUEN_FAST;
+    impls[ZHANG_SUEN_FAST].fn = [](VoronoiThinner & thinner, const cv::Mat1b & img,
+                                   bool crop_img_before, int max_iters) {
+      return thinner.thin_zhang_suen_fast(img, crop_img_before, max_iters);
+    };
+    impls[ZHANG_SUEN_BITBOARD].name = IMPL_ZHANG_SUEN_BITBOARD;
+    impls[ZHANG_SUEN_BITBOARD].fn = [](VoronoiThinner & thinner, const cv::Mat1b & img,
+                                       bool crop_img_before, int max_iters) {
+      return thinner.thin_bitboard(img, false, crop_img_before, max_iters);
+    };
+    impls[DISTANCE_TRANSFORM].name = IMPL_DISTANCE_TRANSFORM;
+    impls[DISTANCE_TRANSFORM].fn = [](VoronoiThinner & thinner, const cv::Mat1b & img,
+                                      bool crop_img_before, int max_iters) {
+      return thinner.thin_distance_transform(img, crop_img_before, max_iters);
+    };
+    return impls;
   }
 
   //////////////////////////////////////////////////////////////////////////////
   //////////////////////////////////////////////////////////////////////////////
 
   cv::Rect _bbox;
+  // the working images are workspaces on the memory of the buffers,
+  // so that repeated calls to thin() do not allocate, \see fit_workspace()
   cv::Mat1b skel;
-  // geometric algo
-  cv::Mat1b img_copy;
+  std::vector<uchar> skel_buffer;
   cv::Mat1b temp;
-  cv::Mat eroded;
-  cv::Mat dilated;
-  cv::Mat element;
+  std::vector<uchar> temp_buffer;
+  // geometric algo
+  cv::Mat1b img_copy, eroded;
+  std::vector<uchar> img_copy_buffer, eroded_buffer;
+  //! rows of ones and zeros, for the outside of the image
+  std::vector<uchar> morph_ones, morph_zeros;
+  //! the kernels of morph_iter(), for the instructions of begin_morph()
+  RowKernels::MorphErodeRowFn morph_erode_fn;
+  RowKernels::MorphResidueRowFn morph_residue_fn;
+  //! the bounding box of the non-zero pixels of img_copy
+  cv::Rect morph_window;
   bool _has_converged;
-  // Zhang-Suen
-  // Guo Hall
-  //cv::Mat1b marker;
-  std::deque<int> marker_;
+  RowKernels::Instructions _instructions;
+  // multi-threading
+  //! the minimum number of rows of a band processed by a thread
+  static const int MIN_BAND_ROWS = 16;
+  int _nthreads;
+  std::unique_ptr<ThreadPool> _pool;
+  //! true for the bands where a pixel was set to 0
+  std::vector<uchar> band_changed;
+  // active rows of the row by row implementations
+  //! 1 for the rows where a pixel was set to 0 in the last sub-iteration
+  std::vector<uchar> rows_changed;
+  //! rows_changed of the sub-iteration before the last one
+  std::vector<uchar> rows_changed_prev;
+  //! 1 for the rows to examine in the current sub-iteration
+  std::vector<uchar> rows_active;
+  //! true if temp holds the image before the last sub-iteration
+  bool rows_synced;
+  // sparse outputs
+  SparseSkeleton _sparse;
+  //! true if the implementation gathered the sparse outputs
+  bool _sparse_done;
+  //! the position of the image given to the implementation, \see begin_thin()
+  cv::Point _origin;
+  // step-wise thinning, \see begin()
+  //! the implementation given to begin(), -1 if the thinning is not step-wise
+  int _step_implementation;
+  bool _step_crop;
+  //! the size of the image given to begin()
+  cv::Size _step_size;
+  //! the number of iterations done by step()
+  int _step_niters;
+  //! true if current() wrote the skeleton
+  bool _step_finished;
+  //! skel and _bbox before current()
+  cv::Mat1b _step_skel;
+  cv::Rect _step_bbox;
+  //! a copy of the image, for the implementations that can not be resumed
+  cv::Mat1b step_img;
+  std::vector<uchar> step_img_buffer;
+  // run-length input
+  cv::Mat1b runs_img;
+  std::vector<uchar> runs_img_buffer;
+  // statistics
+  ThinningStats _stats;
+  std::chrono::steady_clock::time_point _stats_time;
+  //! the number of non-zero pixels of the image to thin, -1 if unknown
+  long _stats_npixels_before;
+  // Zhang-Suen original, Guo Hall original
+  cv::Mat1b marker, prev, diff;
+  std::vector<uchar> marker_buffer, prev_buffer, diff_buffer;
   // Zhang-Suen fast
   ImageContour skelcontour;
+  //! keys (row * cols + col) of the contour pixels to examine in the current iteration
+  std::vector<int> contour;
+  //! keys of the contour pixels to examine in the next iteration
+  std::vector<int> next_contour;
   //! list of keys to set to 0 at the end of the iteration
-  std::deque<int> cols_to_set;
-  std::deque<int> rows_to_set;
+  std::vector<int> keys_to_set;
+  // bitboard
+  int bitboard_words; //!< number of 64-bit words per row
+  std::vector<uint64_t> bitboard, bitboard_next, bitboard_interior;
+  // distance transform
+  std::vector<int> dt_column; //!< distance to the nearest 0 pixel of the column
+  std::vector<int> dt_dist2; //!< squared distance to the nearest 0 pixel
+  std::vector<uchar> dt_ridge; //!< 1 for the local maxima of dt_dist2
+  std::vector<int> dt_sites, dt_starts; //!< lower envelope of a row
+  std::vector<int> dt_bucket_start, dt_order, dt_survivors;
+  unsigned int dt_next; //!< the index in dt_order of the next pixel to visit
+  int dt_niters; //!< the number of distance_transform_step()
+  bool dt_survivors_done; //!< true if the survivors were visited again
 }; // end class VoronoiThinner
 
 #endif // VORONOI_H
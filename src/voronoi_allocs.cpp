@@ -0,0 +1,124 @@
+/*!
+  \file        voronoi_allocs.cpp
+  \author      Arnaud Ramey <arnaud.a.ramey@gmail.com>
+                -- Robotics Lab, University Carlos III of Madrid
+  \date        2026/10/18
+
+________________________________________________________________________________
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+________________________________________________________________________________
+
+Checks that VoronoiThinner::thin() does not allocate any memory
+once it has thinned the largest image.
+
+To count the heap allocations, this program replaces malloc() and its
+variants for the whole process: it is a test target of its own,
+so that the voronoi program keeps the allocator of the C library.
+
+ */
+#include <atomic>
+#include <errno.h> // ENOMEM
+#include <opencv2/highgui/highgui.hpp>
+#include "voronoi.h"
+
+#ifdef __GLIBC__
+// count all the heap allocations of the process
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+}
+static std::atomic<long> nallocs(0);
+extern "C" void* malloc(size_t size) noexcept {
+  ++nallocs;
+  return __libc_malloc(size);
+}
+extern "C" void* calloc(size_t n, size_t size) noexcept {
+  ++nallocs;
+  return __libc_calloc(n, size);
+}
+extern "C" void* realloc(void* ptr, size_t size) noexcept {
+  ++nallocs;
+  return __libc_realloc(ptr, size);
+}
+extern "C" int posix_memalign(void** ptr, size_t alignment, size_t size) noexcept {
+  ++nallocs;
+  *ptr = __libc_memalign(alignment, size);
+  return (*ptr ? 0 : ENOMEM);
+}
+#endif // __GLIBC__
+
+////////////////////////////////////////////////////////////////////////////////
+
+/*! thin all \a files twice with the same thinner:
+ * once the thinner has seen the largest image,
+ * the second pass must not allocate any memory.
+ * \return the number of heap allocations of the second pass,
+ *    -1 if they can not be counted
+ */
+long count_allocs(const std::vector<cv::Mat1b> & files,
+                  const std::string & implementation_name) {
+#ifdef __GLIBC__
+  VoronoiThinner thinner;
+  int implementation = VoronoiThinner::implementation_id(implementation_name);
+  long nallocs_warmup = 0;
+  for (unsigned int pass = 0; pass < 2; ++pass) {
+    if (pass == 1)
+      nallocs_warmup = nallocs;
+    for (unsigned int file_idx = 0; file_idx < files.size(); ++file_idx) {
+      for (unsigned int crop = 0; crop <= 1; ++crop)
+        thinner.thin(files[file_idx], implementation, crop);
+    } // end loop file_idx
+  } // end loop pass
+  return nallocs - nallocs_warmup;
+#else // __GLIBC__
+  (void) files;
+  (void) implementation_name;
+  return -1;
+#endif // __GLIBC__
+} // end count_allocs();
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    printf("Usage: %s <implementation_name> <files>\n", argv[0]);
+    printf(" * implementation_name: [%s]\n",
+           VoronoiThinner::all_implementations_as_string().c_str());
+    printf("Example: %s guo_hall frame*.png\n", argv[0]);
+    return -1;
+  }
+  std::string implementation_name (argv[1]);
+  if (VoronoiThinner::implementation_id_or_warn(implementation_name) < 0)
+    return -1;
+  std::vector<cv::Mat1b> files;
+  for (int argi = 2; argi < argc; ++argi) {
+    cv::Mat1b file = cv::imread(argv[argi], CV_LOAD_IMAGE_GRAYSCALE);
+    if (file.empty())
+      printf("Could not load file '%s'\n", argv[argi]);
+    else
+      files.push_back(file);
+  } // end loop argi
+
+  long nallocs_after_warmup = count_allocs(files, implementation_name);
+  if (nallocs_after_warmup < 0) {
+    printf("Heap allocations can only be counted with the GNU C library\n");
+    return -1;
+  }
+  printf("Heap allocations of %s after warm-up (%i files): %li\n",
+         implementation_name.c_str(), (int) files.size(), nallocs_after_warmup);
+  return (nallocs_after_warmup ? -1 : 0);
+}
@@ -0,0 +1,257 @@
+/*!
+  \file        voronoi_batch.h
+  \author      Arnaud Ramey <arnaud.a.ramey@gmail.com>
+                -- Robotics Lab, University Carlos III of Madrid
+  \date        2026/10/18
+
+________________________________________________________________________________
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+________________________________________________________________________________
+
+\class VoronoiBatchThinner thins many images concurrently,
+with one VoronoiThinner per worker of a thread pool.
+The results are given in the order of the input images.
+
+thin_pipelined() overlaps the reading of the images, their thinning and
+the writing of the results: the source and the sink run on threads of
+their own, connected to the workers by bounded queues.
+The images in flight are recycled, so the memory does not depend on
+the number of images.
+
+ */
+
+#ifndef VORONOI_BATCH_H
+#define VORONOI_BATCH_H
+
+#include "bounded_queue.h"
+#include "voronoi.h"
+
+class VoronoiBatchThinner {
+public:
+  //! a source of images: \return false when there is no more image
+  typedef std::function<bool(cv::Mat1b &)> Source;
+  //! a sink of results, called in the order of the input images
+  typedef std::function<void(int img_idx, bool success,
+                             const cv::Mat1b & skel, const cv::Rect & bbox)> Sink;
+
+  /*! \param nthreads
+   *  the number of images thinned concurrently,
+   *  <= 0 for the number of concurrent threads supported by the machine
+   */
+  explicit VoronoiBatchThinner(int nthreads = 0)
+    : _pool(nthreads > 0 ? nthreads : std::max(1u, std::thread::hardware_concurrency())) {
+    for (int worker = 0; worker < _pool.size(); ++worker)
+      _thinners.push_back(std::unique_ptr<VoronoiThinner>(new VoronoiThinner()));
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! \return the number of images thinned concurrently
+  inline int get_nthreads() const { return _pool.size(); }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*!
+   * thin the images given by \a source, \see VoronoiThinner::thin().
+   * The images are read by chunks of a few images per thread,
+   * so the source can be larger than the memory.
+   * \param source
+   *    an empty image is not thinned, it is given to \a sink as a failure
+   * \param sink
+   *    called for each image, in the order of the images in \a source.
+   *    \a skel is only valid during the call, empty if thinning failed.
+   * \return
+   *    false if \a implementation_name is not a supported implementation
+   */
+  bool thin(const Source & source,
+            const Sink & sink,
+            const std::string & implementation_name,
+            bool crop_img_before = true,
+            int max_iters = VoronoiThinner::NOLIMIT) {
+    int implementation = VoronoiThinner::implementation_id_or_warn(implementation_name);
+    if (implementation < 0)
+      return false;
+    unsigned int chunk_size = CHUNK_IMGS_PER_THREAD * _pool.size();
+    _imgs.resize(chunk_size);
+    _skels.resize(chunk_size);
+    _bboxes.resize(chunk_size);
+    _success.resize(chunk_size);
+    int first_img_idx = 0;
+    bool source_empty = false;
+    while (!source_empty) {
+      // read a chunk
+      unsigned int nimgs = 0;
+      while (nimgs < chunk_size) {
+        if (!source(_imgs[nimgs])) {
+          source_empty = true;
+          break;
+        }
+        ++nimgs;
+      } // end while (nimgs < chunk_size)
+      // thin it
+      _pool.parallel_for(nimgs, [&](int img_idx, int worker) {
+        VoronoiThinner & thinner = *_thinners[worker];
+        _success[img_idx] = (!_imgs[img_idx].empty()
+                             && thinner.thin(_imgs[img_idx], implementation,
+                                             crop_img_before, max_iters));
+        if (_success[img_idx]) {
+          thinner.get_skeleton().copyTo(_skels[img_idx]);
+          _bboxes[img_idx] = thinner.get_bbox();
+        }
+        else {
+          _skels[img_idx].release();
+          _bboxes[img_idx] = cv::Rect();
+        }
+      });
+      for (unsigned int img_idx = 0; img_idx < nimgs; ++img_idx)
+        sink(first_img_idx + img_idx, _success[img_idx],
+             _skels[img_idx], _bboxes[img_idx]);
+      first_img_idx += nimgs;
+    } // end while (!source_empty)
+    return true;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*!
+   * thin the images given by \a source, \see VoronoiThinner::thin().
+   * \a source is called on a thread of its own, \a sink on another one,
+   * both concurrently with the thinning: while the workers thin some
+   * images, the next ones are read and the previous results are written.
+   * At most CHUNK_IMGS_PER_THREAD images per thread are in flight,
+   * so the source can be larger than the memory.
+   * \param source
+   *    an empty image is not thinned, it is given to \a sink as a failure
+   * \param sink
+   *    called for each image, in the order in which they are thinned,
+   *    \a img_idx being the index of the image in \a source.
+   *    \a skel is only valid during the call, empty if thinning failed.
+   * \return
+   *    false if \a implementation_name is not a supported implementation
+   */
+  bool thin_pipelined(const Source & source,
+                      const Sink & sink,
+                      const std::string & implementation_name,
+                      bool crop_img_before = true,
+                      int max_iters = VoronoiThinner::NOLIMIT) {
+    int implementation = VoronoiThinner::implementation_id_or_warn(implementation_name);
+    if (implementation < 0)
+      return false;
+    // the images in flight go round: free -> to_thin -> to_sink -> free
+    unsigned int nitems = CHUNK_IMGS_PER_THREAD * _pool.size();
+    _items.resize(nitems);
+    BoundedQueue<PipelineItem*> free_items(nitems), to_thin(nitems), to_sink(nitems);
+    for (unsigned int item_idx = 0; item_idx < nitems; ++item_idx)
+      free_items.push(&_items[item_idx]);
+
+    std::thread reader([&]() {
+      PipelineItem* item;
+      for (int img_idx = 0; free_items.pop(item); ++img_idx) {
+        if (!source(item->img))
+          break;
+        item->img_idx = img_idx;
+        to_thin.push(item);
+      } // end loop img_idx
+      to_thin.close();
+    });
+    std::thread writer([&]() {
+      PipelineItem* item;
+      while (to_sink.pop(item)) {
+        sink(item->img_idx, item->success, item->skel, item->bbox);
+        free_items.push(item);
+      } // end while (to_sink.pop(item))
+    });
+    // each worker thins images until the reader is done
+    _pool.parallel_for(_pool.size(), [&](int /*task*/, int worker) {
+      VoronoiThinner & thinner = *_thinners[worker];
+      PipelineItem* item;
+      while (to_thin.pop(item)) {
+        item->success = (!item->img.empty()
+                         && thinner.thin(item->img, implementation,
+                                         crop_img_before, max_iters));
+        if (item->success) {
+          thinner.get_skeleton().copyTo(item->skel);
+          item->bbox = thinner.get_bbox();
+        }
+        else {
+          item->skel.release();
+          item->bbox = cv::Rect();
+        }
+        to_sink.push(item);
+      } // end while (to_thin.pop(item))
+    });
+    reader.join();
+    to_sink.close();
+    writer.join();
+    return true;
+  }
+
+  /*!
+   * thin all images of \a imgs, \see VoronoiThinner::thin().
+   * \param skels, bboxes
+   *    the skeleton and the bounding box of each image,
+   *    as given by VoronoiThinner::get_skeleton() and VoronoiThinner::get_bbox(),
+   *    an empty skeleton and bounding box if it could not be thinned,
+   *    for instance if it is empty
+   * \return
+   *    false if \a implementation_name is not a supported implementation
+   */
+  bool thin(const std::vector<cv::Mat1b> & imgs,
+            std::vector<cv::Mat1b> & skels,
+            std::vector<cv::Rect> & bboxes,
+            const std::string & implementation_name,
+            bool crop_img_before = true,
+            int max_iters = VoronoiThinner::NOLIMIT) {
+    skels.resize(imgs.size());
+    bboxes.resize(imgs.size());
+    unsigned int next_img = 0;
+    return thin([&](cv::Mat1b & img) {
+      if (next_img >= imgs.size())
+        return false;
+      img = imgs[next_img++]; // shallow copy
+      return true;
+    }, [&](int img_idx, bool success, const cv::Mat1b & skel, const cv::Rect & bbox) {
+      if (success)
+        skel.copyTo(skels[img_idx]);
+      else
+        skels[img_idx].release();
+      bboxes[img_idx] = bbox;
+    }, implementation_name, crop_img_before, max_iters);
+  }
+
+protected:
+  //! the number of images read from the source at once, per thread
+  static const unsigned int CHUNK_IMGS_PER_THREAD = 4;
+
+  //! an image in flight in thin_pipelined()
+  struct PipelineItem {
+    int img_idx;
+    cv::Mat1b img, skel;
+    cv::Rect bbox;
+    bool success;
+  };
+
+  ThreadPool _pool;
+  //! one thinner per worker of _pool
+  std::vector<std::unique_ptr<VoronoiThinner> > _thinners;
+  // current chunk
+  std::vector<cv::Mat1b> _imgs, _skels;
+  std::vector<cv::Rect> _bboxes;
+  std::vector<uchar> _success;
+  // images in flight of thin_pipelined()
+  std::vector<PipelineItem> _items;
+}; // end class VoronoiBatchThinner
+
+#endif // VORONOI_BATCH_H
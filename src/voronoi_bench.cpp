@@ -0,0 +1,373 @@
+/*!
+  \file        voronoi_bench.cpp
+  \author      Arnaud Ramey <arnaud.a.ramey@gmail.com>
+                -- Robotics Lab, University Carlos III of Madrid
+  \date        2026/10/18
+
+________________________________________________________________________________
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+________________________________________________________________________________
+
+Benchmark suite for VoronoiThinner.
+
+Each implementation is timed on synthetic images, made of random strokes,
+for all combinations of image size, fill ratio, stroke thickness
+and number of threads, or on the given image files.
+Each measure is made of warm-up runs, that are not timed,
+then of repeated samples timed with a monotonic clock.
+The median, 95th and 99th percentiles of the samples are written
+in CSV or JSON, to compare the results between releases.
+
+ */
+#include <algorithm>
+#include <chrono>
+#include <math.h> // ceil
+#include <random>
+#include <sstream>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include "voronoi.h"
+
+//! the parameters of the benchmark
+struct BenchParams {
+  std::vector<int> implementations;
+  std::vector<int> sizes, thicknesses, nthreads;
+  std::vector<double> fills;
+  int nwarmups, nsamples;
+  bool json;
+  std::string output_filename;
+  std::vector<std::string> files;
+
+  BenchParams() : nwarmups(3), nsamples(20), json(false) {
+    for (int impl = 0; impl < VoronoiThinner::NBUILTIN_IMPLEMENTATIONS; ++impl)
+      implementations.push_back(impl);
+    sizes.push_back(256);
+    sizes.push_back(512);
+    fills.push_back(.1);
+    fills.push_back(.4);
+    thicknesses.push_back(4);
+    thicknesses.push_back(16);
+    nthreads.push_back(1);
+    int max_threads = std::thread::hardware_concurrency();
+    if (max_threads > 1)
+      nthreads.push_back(max_threads);
+  }
+}; // end struct BenchParams
+
+//! the result of the benchmark of one implementation on one image
+struct BenchResult {
+  std::string implementation, input;
+  int cols, rows, thickness, nthreads, nsamples;
+  double fill;
+  double median_ms, p95_ms, p99_ms;
+  //! the number of pixels of the image thinned per second, for the median time
+  double pixels_per_second;
+}; // end struct BenchResult
+
+////////////////////////////////////////////////////////////////////////////////
+
+/*!
+ * draw random strokes of thickness \a thickness in a square image
+ * of side \a size, until a ratio \a fill of its pixels are non-zero.
+ * The same parameters always give the same image.
+ */
+cv::Mat1b generate_strokes(int size, double fill, int thickness) {
+  cv::Mat1b img(size, size);
+  img.setTo(0);
+  std::mt19937 rng(size * 1000 + thickness);
+  std::uniform_int_distribution<int> coord(0, size - 1);
+  int npixels = size * size, nnonzero = 0;
+  for (int stroke = 0; stroke < 10000 && nnonzero < fill * npixels; ++stroke) {
+    cv::Point p1(coord(rng), coord(rng)), p2(coord(rng), coord(rng));
+    cv::line(img, p1, p2, cv::Scalar(255), thickness);
+    nnonzero = cv::countNonZero(img);
+  } // end loop stroke
+  return img;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! \return the percentile \a ratio (in [0, 1]) of \a sorted, by nearest rank
+inline double percentile(const std::vector<double> & sorted, double ratio) {
+  int rank = (int) ceil(ratio * sorted.size()) - 1;
+  return sorted[std::max(0, std::min(rank, (int) sorted.size() - 1))];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/*! time the implementation \a implementation on \a img
+ * \return false if thinning failed
+ */
+bool bench_image(VoronoiThinner & thinner,
+                 const cv::Mat1b & img,
+                 int implementation,
+                 const BenchParams & params,
+                 BenchResult & result) {
+  for (int warmup = 0; warmup < params.nwarmups; ++warmup) {
+    if (!thinner.thin(img, implementation, true))
+      return false;
+  } // end loop warmup
+  std::vector<double> times_ms;
+  for (int sample = 0; sample < params.nsamples; ++sample) {
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    thinner.thin(img, implementation, true);
+    std::chrono::duration<double, std::milli> time
+        = std::chrono::steady_clock::now() - begin;
+    times_ms.push_back(time.count());
+  } // end loop sample
+  std::sort(times_ms.begin(), times_ms.end());
+  result.implementation = VoronoiThinner::implementation_name(implementation);
+  result.cols = img.cols;
+  result.rows = img.rows;
+  result.fill = 1. * cv::countNonZero(img) / (img.cols * img.rows);
+  result.nthreads = thinner.get_nthreads();
+  result.nsamples = params.nsamples;
+  result.median_ms = percentile(times_ms, .5);
+  result.p95_ms = percentile(times_ms, .95);
+  result.p99_ms = percentile(times_ms, .99);
+  result.pixels_per_second = img.cols * img.rows / (result.median_ms / 1000);
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/*! time all implementations of \a params on \a img,
+ * for all the thread counts, and add the results to \a results */
+void bench_all(const cv::Mat1b & img,
+               const std::string & input,
+               int thickness,
+               const BenchParams & params,
+               std::vector<BenchResult> & results) {
+  for (unsigned int thread_idx = 0; thread_idx < params.nthreads.size(); ++thread_idx) {
+    VoronoiThinner thinner;
+    thinner.set_nthreads(params.nthreads[thread_idx]);
+    for (unsigned int impl_idx = 0; impl_idx < params.implementations.size(); ++impl_idx) {
+      BenchResult result;
+      if (!bench_image(thinner, img, params.implementations[impl_idx], params, result))
+        continue;
+      result.input = input;
+      result.thickness = thickness;
+      results.push_back(result);
+      fprintf(stderr, "%s on %s (%i threads): %g ms\n", result.implementation.c_str(),
+              input.c_str(), result.nthreads, result.median_ms);
+    } // end loop impl_idx
+  } // end loop thread_idx
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! \return \a str as a CSV field, quoted if it contains a comma, a quote or a newline
+std::string csv_field(const std::string & str) {
+  if (str.find_first_of(",\"\r\n") == std::string::npos)
+    return str;
+  std::string ans = "\"";
+  for (unsigned int char_idx = 0; char_idx < str.size(); ++char_idx) {
+    if (str[char_idx] == '"')
+      ans += '"'; // quotes are doubled
+    ans += str[char_idx];
+  } // end loop char_idx
+  return ans + "\"";
+}
+
+//! \return \a str as a JSON string, with its quotes
+std::string json_string(const std::string & str) {
+  std::ostringstream out;
+  out << '"';
+  for (unsigned int char_idx = 0; char_idx < str.size(); ++char_idx) {
+    unsigned char c = str[char_idx];
+    if (c == '"' || c == '\\')
+      out << '\\' << c;
+    else if (c == '\n')
+      out << "\\n";
+    else if (c == '\r')
+      out << "\\r";
+    else if (c == '\t')
+      out << "\\t";
+    else if (c < 0x20) {
+      char code[8];
+      snprintf(code, sizeof(code), "\\u%04x", c);
+      out << code;
+    }
+    else
+      out << c;
+  } // end loop char_idx
+  out << '"';
+  return out.str();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+std::string results_to_csv(const std::vector<BenchResult> & results) {
+  std::ostringstream out;
+  out << "implementation,input,cols,rows,fill,thickness,threads,samples,"
+      << "median_ms,p95_ms,p99_ms,pixels_per_second" << std::endl;
+  for (unsigned int res_idx = 0; res_idx < results.size(); ++res_idx) {
+    const BenchResult & r = results[res_idx];
+    out << csv_field(r.implementation) << "," << csv_field(r.input)
+        << "," << r.cols << "," << r.rows
+        << "," << r.fill << "," << r.thickness << "," << r.nthreads
+        << "," << r.nsamples << "," << r.median_ms << "," << r.p95_ms
+        << "," << r.p99_ms << "," << r.pixels_per_second << std::endl;
+  } // end loop res_idx
+  return out.str();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+std::string results_to_json(const std::vector<BenchResult> & results) {
+  std::ostringstream out;
+  out << "[" << std::endl;
+  for (unsigned int res_idx = 0; res_idx < results.size(); ++res_idx) {
+    const BenchResult & r = results[res_idx];
+    out << "  {\"implementation\": " << json_string(r.implementation)
+        << ", \"input\": " << json_string(r.input)
+        << ", \"cols\": " << r.cols << ", \"rows\": " << r.rows
+        << ", \"fill\": " << r.fill << ", \"thickness\": " << r.thickness
+        << ", \"threads\": " << r.nthreads << ", \"samples\": " << r.nsamples
+        << ", \"median_ms\": " << r.median_ms << ", \"p95_ms\": " << r.p95_ms
+        << ", \"p99_ms\": " << r.p99_ms
+        << ", \"pixels_per_second\": " << r.pixels_per_second << "}"
+        << (res_idx + 1 < results.size() ? "," : "") << std::endl;
+  } // end loop res_idx
+  out << "]" << std::endl;
+  return out.str();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! split "a,b,c" into its elements
+template<class _T>
+bool parse_list(const std::string & str, std::vector<_T> & out) {
+  out.clear();
+  std::istringstream in(str);
+  std::string elem;
+  while (std::getline(in, elem, ',')) {
+    std::istringstream elem_in(elem);
+    _T value;
+    if (!(elem_in >> value))
+      return false;
+    out.push_back(value);
+  } // end while (getline)
+  return !out.empty();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+inline int bench_help(int /*argc*/, char** argv) {
+  printf("Usage: %s [options] [files]\n", argv[0]);
+  printf("Without files, the implementations are timed on synthetic images.\n");
+  printf("Options:\n");
+  printf(" --impls a,b,...     implementations, among [%s] (default: all)\n",
+         VoronoiThinner::all_implementations_as_string().c_str());
+  printf(" --sizes n,...       side of the synthetic images, in pixels (default: 256,512)\n");
+  printf(" --fills r,...       ratio of non-zero pixels of the synthetic images (default: .1,.4)\n");
+  printf(" --thickness t,...   thickness of the strokes of the synthetic images (default: 4,16)\n");
+  printf(" --threads n,...     numbers of threads (default: 1 and the number of cores)\n");
+  printf(" --warmups n         runs before timing (default: 3)\n");
+  printf(" --samples n         timed runs (default: 20)\n");
+  printf(" --json              write JSON instead of CSV\n");
+  printf(" --output file       write the results in file instead of stdout\n");
+  printf("\nExample:\n");
+  printf("  %s --impls zhang_suen_fast,guo_hall_fast --sizes 1024 --json\n", argv[0]);
+  return -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+  BenchParams params;
+  for (int argi = 1; argi < argc; ++argi) {
+    std::string arg(argv[argi]);
+    bool has_value = (argi + 1 < argc);
+    bool ok = true;
+    if (arg == "--json")
+      params.json = true;
+    else if (arg == "--help" || arg == "-h")
+      return bench_help(argc, argv);
+    else if (arg.substr(0, 2) != "--")
+      params.files.push_back(arg);
+    else if (!has_value)
+      ok = false;
+    else if (arg == "--impls") {
+      std::istringstream in(argv[++argi]);
+      std::string name;
+      params.implementations.clear();
+      while (ok && std::getline(in, name, ',')) {
+        int implementation = VoronoiThinner::implementation_id_or_warn(name);
+        ok = (implementation >= 0);
+        params.implementations.push_back(implementation);
+      } // end while (getline)
+    }
+    else if (arg == "--sizes")
+      ok = parse_list(argv[++argi], params.sizes);
+    else if (arg == "--fills")
+      ok = parse_list(argv[++argi], params.fills);
+    else if (arg == "--thickness")
+      ok = parse_list(argv[++argi], params.thicknesses);
+    else if (arg == "--threads")
+      ok = parse_list(argv[++argi], params.nthreads);
+    else if (arg == "--warmups")
+      params.nwarmups = atoi(argv[++argi]);
+    else if (arg == "--samples")
+      ok = ((params.nsamples = atoi(argv[++argi])) > 0);
+    else if (arg == "--output")
+      params.output_filename = argv[++argi];
+    else
+      ok = false;
+    if (!ok) {
+      printf("Invalid option '%s'\n", arg.c_str());
+      return bench_help(argc, argv);
+    }
+  } // end loop argi
+
+  std::vector<BenchResult> results;
+  if (params.files.empty()) { // synthetic images
+    for (unsigned int size_idx = 0; size_idx < params.sizes.size(); ++size_idx) {
+      for (unsigned int fill_idx = 0; fill_idx < params.fills.size(); ++fill_idx) {
+        for (unsigned int th_idx = 0; th_idx < params.thicknesses.size(); ++th_idx) {
+          int size = params.sizes[size_idx], thickness = params.thicknesses[th_idx];
+          double fill = params.fills[fill_idx];
+          std::ostringstream input;
+          input << "strokes_" << size << "_" << fill << "_" << thickness;
+          bench_all(generate_strokes(size, fill, thickness), input.str(),
+                    thickness, params, results);
+        } // end loop th_idx
+      } // end loop fill_idx
+    } // end loop size_idx
+  }
+  for (unsigned int file_idx = 0; file_idx < params.files.size(); ++file_idx) {
+    cv::Mat1b img = cv::imread(params.files[file_idx], CV_LOAD_IMAGE_GRAYSCALE);
+    if (img.empty()) {
+      printf("Could not load file '%s'\n", params.files[file_idx].c_str());
+      continue;
+    }
+    bench_all(img, params.files[file_idx], -1, params, results);
+  } // end loop file_idx
+
+  std::string out = (params.json ? results_to_json(results) : results_to_csv(results));
+  if (params.output_filename.empty()) {
+    printf("%s", out.c_str());
+    return 0;
+  }
+  FILE* file = fopen(params.output_filename.c_str(), "w");
+  if (!file) {
+    printf("Could not write file '%s'\n", params.output_filename.c_str());
+    return -1;
+  }
+  fprintf(file, "%s", out.c_str());
+  fclose(file);
+  printf("Written file '%s'\n", params.output_filename.c_str());
+  return 0;
+}
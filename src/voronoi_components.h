@@ -0,0 +1,282 @@
+/*!
+  \file        voronoi_components.h
+  \author      Arnaud Ramey <arnaud.a.ramey@gmail.com>
+                -- Robotics Lab, University Carlos III of Madrid
+  \date        2026/10/18
+
+________________________________________________________________________________
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+________________________________________________________________________________
+
+\class VoronoiComponentThinner thins separately the 8-connected components
+of the pixels > VoronoiThinner::THRESHOLD of an image, for instance several users or scattered obstacles,
+instead of the bounding box of all of them.
+Each component is cropped to its own bounding box, plus a border of one pixel,
+and the components are thinned concurrently on a thread pool.
+The small components are grouped, so that each task has enough pixels.
+
+The Zhang-Suen and Guo-Hall thinnings of a pixel only depend on its
+3x3 neighbourhood: the skeleton is the same as the one of
+VoronoiThinner::thin(). It is not exactly the case for the morphological one.
+
+ */
+
+#ifndef VORONOI_COMPONENTS_H
+#define VORONOI_COMPONENTS_H
+
+#include <algorithm>
+#include <string.h> // memcpy
+#include "voronoi.h"
+
+class VoronoiComponentThinner {
+public:
+  /*! \param nthreads
+   *  the number of components thinned concurrently,
+   *  <= 0 for the number of concurrent threads supported by the machine
+   */
+  explicit VoronoiComponentThinner(int nthreads = 0)
+    : _pool(nthreads > 0 ? nthreads : std::max(1u, std::thread::hardware_concurrency())) {
+    for (int worker = 0; worker < _pool.size(); ++worker)
+      _thinners.push_back(std::unique_ptr<VoronoiThinner>(new VoronoiThinner()));
+    _crops.resize(_pool.size());
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! \return the number of components thinned concurrently
+  inline int get_nthreads() const { return _pool.size(); }
+
+  //! \return the number of 8-connected components of the last image
+  inline int get_ncomponents() const { return _components.size(); }
+
+  /*! \return the skeleton of the last image, of the size of the image.
+   * All non zero pixels correspond to the skeleton.
+   */
+  inline const cv::Mat1b & get_skeleton() const { return _skel; }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*!
+   * thin the pixels of \a img > VoronoiThinner::THRESHOLD, component by component,
+   * \see VoronoiThinner::thin().
+   * \return
+   *    false if \a implementation_name is not a supported implementation
+   *    or if the thinning of a component failed
+   */
+  bool thin(const cv::Mat1b & img,
+            const std::string & implementation_name,
+            int max_iters = VoronoiThinner::NOLIMIT) {
+    int implementation = VoronoiThinner::implementation_id_or_warn(implementation_name);
+    if (implementation < 0)
+      return false;
+    _skel.create(img.size());
+    _skel.setTo(0);
+    label_components(img);
+    make_tasks();
+    int ntasks = _tasks.size() - 1;
+    _task_success.assign(ntasks, 1);
+    _pool.parallel_for(ntasks, [&](int task, int worker) {
+      for (int comp_idx = _tasks[task]; comp_idx < _tasks[task + 1]; ++comp_idx)
+        if (!thin_component(img, _components[comp_idx], implementation,
+                            max_iters, worker))
+          _task_success[task] = 0;
+    });
+    return std::find(_task_success.begin(), _task_success.end(), 0) == _task_success.end();
+  }
+
+protected:
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! the pixels > VoronoiThinner::THRESHOLD [begin, end) of a row
+  typedef ImageContour::Run Run;
+
+  struct Component {
+    int npixels;
+    cv::Rect bbox;
+    //! its runs are _component_runs[first_run, first_run + nruns)
+    int first_run, nruns;
+  };
+
+  //! the minimum number of pixels of a task of the pool
+  static const int MIN_TASK_PIXELS = 4096;
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! the root of the run \a run in _parents
+  inline int find_root(int run) {
+    while (_parents[run] != run) {
+      _parents[run] = _parents[_parents[run]]; // path halving
+      run = _parents[run];
+    }
+    return run;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! label the 8-connected components of the pixels of \a img
+   * > VoronoiThinner::THRESHOLD, the ones that VoronoiThinner::thin() keeps.
+   * The pixels are grouped in horizontal runs, that are merged with
+   * the runs of the previous row they touch.
+   * Fills _components and _component_runs.
+   */
+  void label_components(const cv::Mat1b & img) {
+    _runs.clear();
+    _parents.clear();
+    unsigned int prev_row_begin = 0, prev_row_end = 0; // runs of the previous row
+    for (int row = 0; row < img.rows; ++row) {
+      const uchar* img_ptr = img.ptr<uchar>(row);
+      unsigned int prev_run = prev_row_begin, row_begin = _runs.size();
+      int col = 0;
+      while (true) {
+        while (col < img.cols && img_ptr[col] <= VoronoiThinner::THRESHOLD)
+          ++col;
+        if (col == img.cols)
+          break;
+        Run run;
+        run.row = row;
+        run.begin = col;
+        while (col < img.cols && img_ptr[col] > VoronoiThinner::THRESHOLD)
+          ++col;
+        run.end = col;
+        int run_idx = _runs.size();
+        _runs.push_back(run);
+        _parents.push_back(run_idx);
+        // the runs of the previous row in [begin - 1, end + 1)
+        while (prev_run < prev_row_end && _runs[prev_run].end < run.begin)
+          ++prev_run;
+        for (unsigned int other = prev_run;
+             other < prev_row_end && _runs[other].begin <= run.end; ++other) {
+          int a = find_root(run_idx), b = find_root(other);
+          _parents[std::max(a, b)] = std::min(a, b);
+        } // end loop other
+      } // end while (true)
+      prev_row_begin = row_begin;
+      prev_row_end = _runs.size();
+    } // end loop row
+
+    // one component per root, its runs sorted by component
+    _components.clear();
+    _component_of_run.resize(_runs.size());
+    for (unsigned int run_idx = 0; run_idx < _runs.size(); ++run_idx) {
+      const Run & run = _runs[run_idx];
+      int root = find_root(run_idx);
+      if (root == (int) run_idx) { // the roots are the first runs of the components
+        Component comp;
+        comp.npixels = 0;
+        comp.nruns = 0;
+        comp.bbox = cv::Rect(run.begin, run.row, 0, 0);
+        _component_of_run[run_idx] = _components.size();
+        _components.push_back(comp);
+      }
+      else
+        _component_of_run[run_idx] = _component_of_run[root];
+      Component & comp = _components[_component_of_run[run_idx]];
+      comp.npixels += run.end - run.begin;
+      ++comp.nruns;
+      int right = std::max(comp.bbox.x + comp.bbox.width, run.end);
+      comp.bbox.x = std::min(comp.bbox.x, run.begin);
+      comp.bbox.width = right - comp.bbox.x;
+      comp.bbox.height = run.row + 1 - comp.bbox.y;
+    } // end loop run_idx
+    int first_run = 0;
+    for (unsigned int comp_idx = 0; comp_idx < _components.size(); ++comp_idx) {
+      _components[comp_idx].first_run = first_run;
+      first_run += _components[comp_idx].nruns;
+      _components[comp_idx].nruns = 0;
+    } // end loop comp_idx
+    _component_runs.resize(_runs.size());
+    for (unsigned int run_idx = 0; run_idx < _runs.size(); ++run_idx) {
+      Component & comp = _components[_component_of_run[run_idx]];
+      _component_runs[comp.first_run + comp.nruns++] = run_idx;
+    } // end loop run_idx
+  } // end label_components()
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! sort the components by decreasing size and group the small ones:
+   * the task i thins the components [ _tasks[i], _tasks[i+1] ) */
+  void make_tasks() {
+    std::sort(_components.begin(), _components.end(),
+              [](const Component & a, const Component & b) {
+      return a.npixels > b.npixels;
+    });
+    _tasks.clear();
+    int task_pixels = MIN_TASK_PIXELS;
+    for (unsigned int comp_idx = 0; comp_idx < _components.size(); ++comp_idx) {
+      if (task_pixels >= MIN_TASK_PIXELS) { // new task
+        _tasks.push_back(comp_idx);
+        task_pixels = 0;
+      }
+      task_pixels += _components[comp_idx].npixels;
+    } // end loop comp_idx
+    _tasks.push_back(_components.size());
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! thin the component \a comp of \a img with the thinner of \a worker,
+   * and add its skeleton to _skel.
+   * \return false if the thinning failed */
+  bool thin_component(const cv::Mat1b & img, const Component & comp,
+                      int implementation, int max_iters,
+                      int worker) {
+    const cv::Rect & bbox = comp.bbox;
+    // copy the component with a border of one pixel
+    cv::Mat1b & crop = _crops[worker];
+    crop.create(bbox.height + 2, bbox.width + 2);
+    crop.setTo(0);
+    for (int run_idx = comp.first_run; run_idx < comp.first_run + comp.nruns; ++run_idx) {
+      const Run & run = _runs[_component_runs[run_idx]];
+      memcpy(crop.ptr<uchar>(run.row - bbox.y + 1) + run.begin - bbox.x + 1,
+             img.ptr<uchar>(run.row) + run.begin, run.end - run.begin);
+    } // end loop run_idx
+
+    VoronoiThinner & thinner = *_thinners[worker];
+    if (!thinner.thin(crop, implementation, false, max_iters))
+      return false;
+    // each pixel belongs to one component: only its skeleton pixels are written
+    const cv::Mat1b & skel = thinner.get_skeleton();
+    for (int row = 0; row < bbox.height; ++row) {
+      const uchar* skel_ptr = skel.ptr<uchar>(row + 1) + 1;
+      uchar* out_ptr = _skel.ptr<uchar>(bbox.y + row) + bbox.x;
+      for (int col = 0; col < bbox.width; ++col)
+        if (skel_ptr[col])
+          out_ptr[col] = skel_ptr[col];
+    } // end loop row
+    return true;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  ThreadPool _pool;
+  //! one thinner and one crop per worker of _pool
+  std::vector<std::unique_ptr<VoronoiThinner> > _thinners;
+  std::vector<cv::Mat1b> _crops;
+  //! the runs of the image, row by row
+  std::vector<Run> _runs;
+  //! the union-find forest of the runs
+  std::vector<int> _parents;
+  //! the index in _components of each run
+  std::vector<int> _component_of_run;
+  //! the indices of the runs, component by component
+  std::vector<int> _component_runs;
+  std::vector<Component> _components;
+  std::vector<int> _tasks;
+  //! 0 for the tasks where the thinning of a component failed
+  std::vector<uchar> _task_success;
+  cv::Mat1b _skel;
+}; // end class VoronoiComponentThinner
+
+#endif // VORONOI_COMPONENTS_H
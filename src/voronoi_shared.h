@@ -0,0 +1,213 @@
+/*!
+  \file        voronoi_shared.h
+  \author      Arnaud Ramey <arnaud.a.ramey@gmail.com>
+                -- Robotics Lab, University Carlos III of Madrid
+  \date        2026/10/18
+
+________________________________________________________________________________
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+________________________________________________________________________________
+
+\class VoronoiSharedThinner is a thinner that many threads can share:
+its configuration (implementation, cropping, iterations) is set once
+by the constructor, and thin() is const.
+The instructions, number of threads and sparse outputs of the thinners
+are copied from a prototype VoronoiThinner given to the constructor,
+and applied to every thinner of the pool.
+
+The working images of each call are the ones of a VoronoiThinner
+borrowed from a pool, and given back at the end of the call.
+The pool is a fixed array of slots, taken and given back with atomic
+exchanges, without any lock. When all the slots are empty,
+because more threads than slots are thinning, a new VoronoiThinner is built;
+when all the slots are full, the one given back is deleted.
+Once each thread has thinned its largest image, thin() does not allocate
+any memory besides the output.
+
+The registry of implementations is read without any lock:
+VoronoiThinner::register_implementation() must not be called
+while threads are calling thin().
+
+ */
+
+#ifndef VORONOI_SHARED_H
+#define VORONOI_SHARED_H
+
+#include <atomic>
+#include "voronoi.h"
+
+class VoronoiSharedThinner {
+public:
+  //! the outputs of thin(), \see VoronoiThinner::get_skeleton()
+  struct Result {
+    bool success;
+    cv::Mat1b skel;
+    cv::Rect bbox;
+    bool has_converged;
+    //! the sparse outputs of the prototype, \see VoronoiThinner::get_sparse_skeleton()
+    SparseSkeleton sparse;
+  };
+
+  //! the default number of pooled thinners
+  static const unsigned int DEFAULT_POOL_SIZE = 16;
+
+  /*!
+   * \param implementation_name, crop_img_before, max_iters
+   *    the parameters of all calls to thin(), \see VoronoiThinner::thin().
+   *    If the implementation does not exist, the supported ones are displayed
+   *    and thin() returns false.
+   * \param pool_size
+   *    the number of thinners kept between the calls,
+   *    at least the number of threads that thin concurrently
+   */
+  explicit VoronoiSharedThinner(const std::string & implementation_name = IMPL_ZHANG_SUEN_FAST,
+                                bool crop_img_before = true,
+                                int max_iters = VoronoiThinner::NOLIMIT,
+                                unsigned int pool_size = DEFAULT_POOL_SIZE)
+    : VoronoiSharedThinner(VoronoiThinner(), implementation_name,
+                           crop_img_before, max_iters, pool_size) {}
+
+  /*!
+   * \param prototype
+   *    the thinner whose instructions, number of threads and sparse outputs
+   *    are given to the pooled thinners, \see VoronoiThinner::set_instructions(),
+   *    VoronoiThinner::set_nthreads(), VoronoiThinner::set_sparse_outputs().
+   *    It is only read by the constructor.
+   * \param implementation_name, crop_img_before, max_iters, pool_size
+   *    \see the other constructor
+   */
+  VoronoiSharedThinner(const VoronoiThinner & prototype,
+                       const std::string & implementation_name = IMPL_ZHANG_SUEN_FAST,
+                       bool crop_img_before = true,
+                       int max_iters = VoronoiThinner::NOLIMIT,
+                       unsigned int pool_size = DEFAULT_POOL_SIZE)
+    : _implementation_name(implementation_name),
+      _implementation(VoronoiThinner::implementation_id_or_warn(implementation_name)),
+      _crop_img_before(crop_img_before),
+      _max_iters(max_iters),
+      _instructions(prototype.get_instructions()),
+      _nthreads(prototype.get_nthreads()),
+      _sparse_outputs(prototype.get_sparse_outputs()),
+      _pool_size(std::max(pool_size, 1u)),
+      _pool(new std::atomic<VoronoiThinner*>[_pool_size]) {
+    for (unsigned int slot = 0; slot < _pool_size; ++slot)
+      _pool[slot].store(NULL);
+  }
+
+  ~VoronoiSharedThinner() {
+    for (unsigned int slot = 0; slot < _pool_size; ++slot)
+      delete _pool[slot].exchange(NULL);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! \return the implementation given to the constructor
+  inline const std::string & get_implementation_name() const { return _implementation_name; }
+  inline bool get_crop_img_before() const { return _crop_img_before; }
+  inline int get_max_iters() const { return _max_iters; }
+  //! \return the settings of the prototype given to the constructor
+  inline RowKernels::Instructions get_instructions() const { return _instructions; }
+  inline int get_nthreads() const { return _nthreads; }
+  inline int get_sparse_outputs() const { return _sparse_outputs; }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*!
+   * thin \a img, \see VoronoiThinner::thin(). Can be called concurrently.
+   * \param skel
+   *    the skeleton of the bounding box \a bbox of the shapes.
+   *    Its memory is reused if it is large enough, as with cv::Mat::create().
+   * \param has_converged
+   *    if not NULL, set to VoronoiThinner::has_converged()
+   * \param sparse
+   *    if not NULL, set to VoronoiThinner::get_sparse_skeleton(),
+   *    with the sparse outputs of the prototype
+   * \return
+   *    false if the implementation given to the constructor is not supported
+   */
+  bool thin(const cv::Mat1b & img,
+            cv::Mat1b & skel,
+            cv::Rect & bbox,
+            bool* has_converged = NULL,
+            SparseSkeleton* sparse = NULL) const {
+    if (_implementation < 0) // displayed by the constructor
+      return false;
+    VoronoiThinner* thinner = borrow();
+    bool success = thinner->thin(img, _implementation, _crop_img_before, _max_iters);
+    if (success) {
+      thinner->get_skeleton().copyTo(skel);
+      bbox = thinner->get_bbox();
+      if (has_converged)
+        *has_converged = thinner->has_converged();
+      if (sparse)
+        *sparse = thinner->get_sparse_skeleton();
+    }
+    give_back(thinner);
+    return success;
+  }
+
+  //! thin \a img, the outputs being returned by value, \see thin()
+  inline Result thin(const cv::Mat1b & img) const {
+    Result result;
+    result.has_converged = false;
+    result.success = thin(img, result.skel, result.bbox, &result.has_converged,
+                          _sparse_outputs ? &result.sparse : NULL);
+    return result;
+  }
+
+protected:
+  /*! \return a thinner of the pool, or a new one if the pool is empty.
+   * The new ones are configured as the prototype;
+   * the pooled ones were built by borrow(), so they already are.
+   */
+  VoronoiThinner* borrow() const {
+    for (unsigned int slot = 0; slot < _pool_size; ++slot) {
+      if (!_pool[slot].load(std::memory_order_relaxed))
+        continue;
+      VoronoiThinner* thinner = _pool[slot].exchange(NULL, std::memory_order_acquire);
+      if (thinner)
+        return thinner;
+    } // end loop slot
+    VoronoiThinner* thinner = new VoronoiThinner();
+    thinner->set_instructions(_instructions);
+    thinner->set_nthreads(_nthreads);
+    thinner->set_sparse_outputs(_sparse_outputs);
+    return thinner;
+  }
+
+  //! put \a thinner in an empty slot of the pool, or delete it if there is none
+  void give_back(VoronoiThinner* thinner) const {
+    for (unsigned int slot = 0; slot < _pool_size; ++slot) {
+      VoronoiThinner* empty = NULL;
+      if (_pool[slot].compare_exchange_strong(empty, thinner, std::memory_order_release,
+                                              std::memory_order_relaxed))
+        return;
+    } // end loop slot
+    delete thinner;
+  }
+
+  const std::string _implementation_name;
+  const int _implementation;
+  const bool _crop_img_before;
+  const int _max_iters;
+  const RowKernels::Instructions _instructions;
+  const int _nthreads;
+  const int _sparse_outputs;
+  const unsigned int _pool_size;
+  //! the thinners that are not borrowed, NULL for the empty slots
+  std::unique_ptr<std::atomic<VoronoiThinner*>[]> _pool;
+}; // end class VoronoiSharedThinner
+
+#endif // VORONOI_SHARED_H
@@ -0,0 +1,325 @@
+/*!
+  \file        voronoi_stream.h
+  \author      Arnaud Ramey <arnaud.a.ramey@gmail.com>
+                -- Robotics Lab, University Carlos III of Madrid
+  \date        2026/10/18
+
+________________________________________________________________________________
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+________________________________________________________________________________
+
+\class VoronoiStreamThinner thins the successive frames of a video
+of masks, for instance the user masks of a depth camera.
+
+Consecutive frames are usually very similar.
+The mask of each frame is compared to the one of the previous frame,
+and only the region around the changed pixels is thinned again:
+the shapes of the new mask that changed are filled in this region,
+surrounded by the skeleton of the previous frame, that is already thin.
+When too many pixels changed, the whole frame is thinned.
+
+The skeleton has the topology of the frame, but it can differ
+from the one of VoronoiThinner::thin(): the branches of the unchanged
+parts are not moved when the shape changes elsewhere.
+That is why the whole frame is also thinned periodically.
+
+ */
+
+#ifndef VORONOI_STREAM_H
+#define VORONOI_STREAM_H
+
+#include "voronoi.h"
+
+class VoronoiStreamThinner {
+public:
+  /*!
+   * \param implementation_name
+   *  the implementation used for thinning, \see VoronoiThinner::thin().
+   *  If it does not exist, the supported ones are displayed
+   *  and thin() returns false.
+   * \param max_changed_ratio
+   *  if the number of changed pixels between two frames is higher than
+   *  this ratio of the number of non-zero pixels, the whole frame is thinned
+   * \param margin
+   *  the number of pixels added around the bounding box of the changed pixels
+   *  to obtain the region that is thinned again
+   * \param full_thin_period
+   *  the whole frame is thinned at least every \a full_thin_period frames,
+   *  so that the skeleton does not drift away from the one of a full thinning.
+   *  1 to thin all frames as a whole.
+   */
+  VoronoiStreamThinner(const std::string & implementation_name = IMPL_ZHANG_SUEN_FAST,
+                       double max_changed_ratio = .1,
+                       int margin = 4,
+                       int full_thin_period = 30)
+    : _implementation_name(implementation_name),
+      _implementation(VoronoiThinner::implementation_id_or_warn(implementation_name)),
+      _max_changed_ratio(max_changed_ratio),
+      _margin(margin),
+      _full_thin_period(full_thin_period),
+      _nframes_since_full_thin(0),
+      _incremental(false) {}
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*!
+   * thin a new frame.
+   * \param frame
+   *  A monochrome image. All pixels > VoronoiThinner::THRESHOLD are considered as part of the shape.
+   * \return
+   *    true if success
+   *    false if the implementation is not a supported implementation
+   */
+  bool thin(const cv::Mat1b & frame) {
+    if (_implementation < 0) // displayed by the constructor
+      return false;
+    cv::threshold(frame, _mask, VoronoiThinner::THRESHOLD, 255, CV_THRESH_BINARY);
+    if (_prev_mask.empty() || _prev_mask.size() != _mask.size()
+        || ++_nframes_since_full_thin >= _full_thin_period)
+      return full_thin();
+
+    // find the changed pixels
+    int nchanged = 0, nnonzero = 0;
+    cv::Rect changed = changed_bbox(_prev_mask, _mask, nchanged, nnonzero);
+    if (nchanged > _max_changed_ratio * std::max(nnonzero, 1))
+      return full_thin();
+    _incremental = true;
+    _roi = cv::Rect();
+    if (nchanged == 0) { // same skeleton
+      std::swap(_mask, _prev_mask);
+      return true;
+    }
+    // grow the region until the changed shapes can be thinned in it
+    int margin = _margin;
+    for (int attempt = 0; attempt < MAX_ATTEMPTS; ++attempt) {
+      if (thin_region(changed, margin)) {
+        std::swap(_mask, _prev_mask);
+        return true;
+      }
+      margin = 2 * margin + 1;
+    } // end loop attempt
+    return full_thin();
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! \return the skeleton of the last frame, of the size of the frame.
+   * All non zero pixels correspond to the skeleton.
+   */
+  inline const cv::Mat1b & get_skeleton() const { return _skel; }
+
+  //! \return true if the last frame was thinned from the previous one
+  inline bool was_incremental() const { return _incremental; }
+
+  /*! \return the region of the last frame that was thinned again,
+   * empty if the mask did not change, or if the whole frame was thinned.
+   */
+  inline cv::Rect get_roi() const { return _roi; }
+
+  //! forget the previous frame: the next one will be thinned as a whole
+  inline void reset() { _prev_mask.release(); }
+
+  //! \return the thinner used for the frames, for instance to configure it
+  inline VoronoiThinner & get_thinner() { return _thinner; }
+
+protected:
+  //////////////////////////////////////////////////////////////////////////////
+
+  bool full_thin() {
+    _incremental = false;
+    _nframes_since_full_thin = 0;
+    _roi = cv::Rect();
+    std::swap(_mask, _prev_mask);
+    if (!_thinner.thin(_prev_mask, _implementation, true))
+      return false;
+    _skel.create(_prev_mask.size());
+    _skel.setTo(0);
+    cv::Mat1b skel_roi = _skel(_thinner.get_bbox());
+    _thinner.get_skeleton().copyTo(skel_roi);
+    return true;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! thin again the changed bounding box \a changed plus \a margin pixels.
+   * Inside this region, the shapes of the new mask that contain a changed
+   * pixel are filled, the others keep the skeleton of the previous frame.
+   * A filled shape that goes on outside of the region must touch
+   * the skeleton of the previous frame just around the region,
+   * otherwise its skeleton would not be connected to the rest.
+   * \return false if it is not the case
+   */
+  bool thin_region(const cv::Rect & changed, int margin) {
+    cv::Rect frame_rect(0, 0, _mask.cols, _mask.rows);
+    _roi = grow(changed, margin) & frame_rect;
+    // two rings of pixels of the previous skeleton around the region:
+    // the skeleton lines that enter the region can not be eroded in the inner one
+    cv::Rect window = grow(_roi, 2) & frame_rect;
+    // the window is surrounded by a border of zeros
+    _window.create(window.height + 2, window.width + 2);
+    _window.setTo(0);
+    int offx = window.x - 1, offy = window.y - 1; // frame -> window coordinates
+    cv::Mat1b window_roi = _window(cv::Rect(1, 1, window.width, window.height));
+    _skel(window).copyTo(window_roi);
+    // inside the region, the previous skeleton must be in the new mask
+    for (int row = _roi.y; row < _roi.br().y; ++row) {
+      const uchar* mask_ptr = _mask.ptr<uchar>(row);
+      uchar* window_ptr = _window.ptr<uchar>(row - offy);
+      for (int col = _roi.x; col < _roi.br().x; ++col)
+        window_ptr[col - offx] &= mask_ptr[col];
+    } // end loop row
+
+    // fill the shapes next to the changed pixels
+    cv::Rect seeds = grow(changed, 1) & frame_rect;
+    for (int row = seeds.y; row < seeds.br().y; ++row) {
+      for (int col = seeds.x; col < seeds.br().x; ++col) {
+        if (!_mask(row, col) || _window(row - offy, col - offx) == FILLED
+            || !is_near_change(row, col))
+          continue;
+        if (!fill_shape(row, col, window, offx, offy))
+          return false;
+      } // end loop col
+    } // end loop row
+
+    for (int row = _roi.y; row < _roi.br().y; ++row) {
+      uchar* window_ptr = _window.ptr<uchar>(row - offy);
+      for (int col = _roi.x; col < _roi.br().x; ++col)
+        if (window_ptr[col - offx] == FILLED)
+          window_ptr[col - offx] = 255;
+    } // end loop row
+
+    if (!_thinner.thin(_window, _implementation, false))
+      return false;
+    // the skeleton of the rings is the one of the previous frame
+    cv::Rect roi_in_window(_roi.x - offx, _roi.y - offy, _roi.width, _roi.height);
+    cv::Mat1b skel_roi = _skel(_roi);
+    _thinner.get_skeleton()(roi_in_window).copyTo(skel_roi);
+    return true;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! \return true if a pixel of the 3x3 neighbourhood of (row, col) changed
+  inline bool is_near_change(int row, int col) const {
+    for (int y = std::max(row - 1, 0); y <= std::min(row + 1, _mask.rows - 1); ++y)
+      for (int x = std::max(col - 1, 0); x <= std::min(col + 1, _mask.cols - 1); ++x)
+        if (_mask(y, x) != _prev_mask(y, x))
+          return true;
+    return false;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! fill in _window the 8-connected shape of the new mask
+   * inside _roi that contains (row, col).
+   * \return false if the shape goes on outside of _roi
+   * without touching the previous skeleton
+   */
+  bool fill_shape(int row, int col, const cv::Rect & window, int offx, int offy) {
+    bool cut = false, touches_skel = false;
+    _window(row - offy, col - offx) = FILLED;
+    _to_fill.clear();
+    _to_fill.push_back(cv::Point(col, row));
+    while (!_to_fill.empty()) {
+      cv::Point pt = _to_fill.back();
+      _to_fill.pop_back();
+      for (int y = pt.y - 1; y <= pt.y + 1; ++y) {
+        for (int x = pt.x - 1; x <= pt.x + 1; ++x) {
+          if (!window.contains(cv::Point(x, y)))
+            continue;
+          uchar & window_val = _window(y - offy, x - offx);
+          if (!_roi.contains(cv::Point(x, y))) { // in the inner ring
+            if (window_val)
+              touches_skel = true;
+            else if (_mask(y, x))
+              cut = true;
+            continue;
+          }
+          if (!_mask(y, x) || window_val == FILLED)
+            continue;
+          window_val = FILLED;
+          _to_fill.push_back(cv::Point(x, y));
+        } // end loop x
+      } // end loop y
+    } // end while (!_to_fill.empty())
+    return touches_skel || !cut;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! \return the bounding box of the pixels that differ between \a a and \a b,
+   * \param nchanged the number of these pixels
+   * \param nnonzero the number of non zero pixels of \a b
+   */
+  static cv::Rect changed_bbox(const cv::Mat1b & a, const cv::Mat1b & b,
+                               int & nchanged, int & nnonzero) {
+    int xmin = a.cols, xmax = -1, ymin = a.rows, ymax = -1;
+    nchanged = nnonzero = 0;
+    for (int row = 0; row < a.rows; ++row) {
+      const uchar *a_ptr = a.ptr<uchar>(row), *b_ptr = b.ptr<uchar>(row);
+      for (int col = 0; col < a.cols; ++col) {
+        if (b_ptr[col])
+          ++nnonzero;
+        if (a_ptr[col] == b_ptr[col])
+          continue;
+        ++nchanged;
+        xmin = std::min(xmin, col);
+        xmax = std::max(xmax, col);
+        ymin = std::min(ymin, row);
+        ymax = std::max(ymax, row);
+      } // end loop col
+    } // end loop row
+    if (!nchanged)
+      return cv::Rect();
+    return cv::Rect(xmin, ymin, 1 + xmax - xmin, 1 + ymax - ymin);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! \return \a r with a border of \a border pixels
+  static inline cv::Rect grow(const cv::Rect & r, int border) {
+    return cv::Rect(r.x - border, r.y - border,
+                    r.width + 2 * border, r.height + 2 * border);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! the value of the filled shapes in _window
+  static const uchar FILLED = 128;
+  //! the number of times the region is grown before thinning the whole frame
+  static const int MAX_ATTEMPTS = 3;
+
+  std::string _implementation_name;
+  //! the index of the implementation, \see VoronoiThinner::implementation_id()
+  int _implementation;
+  double _max_changed_ratio;
+  int _margin;
+  int _full_thin_period, _nframes_since_full_thin;
+  VoronoiThinner _thinner;
+  //! the mask of the previous frame, 0 or 255
+  cv::Mat1b _prev_mask;
+  //! the mask of the current frame, 0 or 255
+  cv::Mat1b _mask;
+  //! the skeleton of the previous frame
+  cv::Mat1b _skel;
+  //! the image thinned again
+  cv::Mat1b _window;
+  //! the pixels of the shape being filled
+  std::vector<cv::Point> _to_fill;
+  cv::Rect _roi;
+  bool _incremental;
+}; // end class VoronoiStreamThinner
+
+#endif // VORONOI_STREAM_H
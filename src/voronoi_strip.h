@@ -0,0 +1,380 @@
+/*!
+  \file        voronoi_strip.h
+  \author      Arnaud Ramey <arnaud.a.ramey@gmail.com>
+                -- Robotics Lab, University Carlos III of Madrid
+  \date        2026/10/18
+
+________________________________________________________________________________
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+________________________________________________________________________________
+
+\class VoronoiStripThinner thins images larger than the memory,
+such as rasterised maps, reading them by horizontal strips of rows
+and writing the skeleton strip by strip.
+
+A sub-iteration of Zhang-Suen or Guo-Hall only depends on the 3x3
+neighbourhood of each pixel. The sub-iterations are chained as the stages
+of a pipeline: as soon as a stage received the rows r - 1, r and r + 1,
+it thins its row r and gives it to the next stage.
+Each stage only keeps its last three rows, so that the memory does not
+depend on the number of rows: for max_iters iterations,
+6 * (max_iters + 1) rows are kept.
+
+The skeleton of thin() is the one of VoronoiThinner::thin()
+with the same max_iters: the image is surrounded by zeros as with VoronoiThinner.
+If the shapes are thin enough to converge in max_iters iterations,
+has_converged() is true and the skeleton is the complete one.
+thin_pgm() streams the written file again through the pipeline
+until it converges: its skeleton is the one of VoronoiThinner::thin()
+without limit.
+The rows are counted on 64 bits.
+
+ */
+
+#ifndef VORONOI_STRIP_H
+#define VORONOI_STRIP_H
+
+#include <fstream>
+#include <functional>
+#include <stdint.h> // int64_t
+#include <stdio.h> // rename, remove
+#include "voronoi.h"
+
+class VoronoiStripThinner {
+public:
+  //! a source of strips of rows: \return false when there is no more row
+  typedef std::function<bool(cv::Mat1b & strip)> Source;
+  /*! a sink of strips of the skeleton, \a first_row being the index of
+   * the first row of \a strip. \return false to stop the thinning */
+  typedef std::function<bool(int64_t first_row, const cv::Mat1b & strip)> Sink;
+
+  /*! the default number of iterations of a pass. Each iteration removes
+   * one layer of pixels on each side of the shapes:
+   * shapes up to ~128 pixels wide converge in one pass */
+  static const int DEFAULT_MAX_ITERS = 63;
+
+  /*!
+   * \param implementation_name
+   *    a Zhang-Suen or Guo-Hall implementation.
+   *    If it does not exist, the supported ones are displayed
+   *    and thin() returns false.
+   * \param max_iters
+   *    the number of iterations of each row in a pass,
+   *    as in VoronoiThinner::thin()
+   * \param strip_rows
+   *    the number of rows of the strips given to the sink, and read from files
+   */
+  explicit VoronoiStripThinner(const std::string & implementation_name = IMPL_ZHANG_SUEN,
+                               int max_iters = DEFAULT_MAX_ITERS,
+                               int strip_rows = 256)
+    : _implementation_name(implementation_name),
+      _implementation(VoronoiThinner::implementation_id_or_warn(implementation_name)),
+      _max_iters(std::max(max_iters, 0)),
+      _strip_rows(std::max(strip_rows, 1)),
+      _instructions(RowKernels::best_instructions()),
+      _has_converged(false),
+      _nrows(0),
+      _npasses(0) {}
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! set the instructions of the row kernels, \see VoronoiThinner::set_instructions()
+  inline void set_instructions(RowKernels::Instructions instructions) {
+    _instructions = RowKernels::supported(instructions);
+  }
+
+  /*! \return true if the last iteration of the last thinning did not change
+   * any pixel: the skeleton is the one of VoronoiThinner::thin() without limit */
+  inline bool has_converged() const { return _has_converged; }
+
+  //! \return the number of rows of the last thinned image
+  inline int64_t get_nrows() const { return _nrows; }
+
+  //! \return the number of passes of the last thin_pgm(), \see thin_pgm()
+  inline int get_npasses() const { return _npasses; }
+
+  //! \return the number of rows of the pipeline kept in memory
+  inline int get_window_rows() const { return 3 * nstages(); }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*!
+   * thin an image given by strips.
+   * \param cols
+   *    the number of columns of the image
+   * \param source
+   *    gives the next strip of rows of the image, of any height.
+   *    All pixels > VoronoiThinner::THRESHOLD are part of the shapes.
+   * \param sink
+   *    receives the skeleton by strips of strip_rows rows, in order,
+   *    the pixels of the skeleton being 255.
+   *    \a strip is only valid during the call.
+   * \return
+   *    false if the implementation can not be streamed,
+   *    if a strip does not have \a cols columns, or if \a sink returned false
+   */
+  bool thin(int cols, const Source & source, const Sink & sink) {
+    if (_implementation < 0) // displayed by the constructor
+      return false;
+    _row_fn = VoronoiThinner::row_kernel(_implementation, _instructions, _tables);
+    if (!_row_fn) {
+      printf("Implementation '%s' can not be thinned by strips, "
+             "only the Zhang-Suen and Guo-Hall ones\n", _implementation_name.c_str());
+      return false;
+    }
+    // the rows have a border of one zero on each side
+    _cols = cols;
+    _width = cols + 2;
+    _rings.assign((size_t) nstages() * 3 * _width, 0);
+    _zeros.assign(_width, 0);
+    _out_row.assign(_width, 0);
+    _out_strip.create(_strip_rows, cols);
+    _nout_rows = 0;
+    _nout_first_row = 0;
+    _nrows = 0;
+    _has_converged = true;
+    _sink = sink;
+    _sink_ok = true;
+
+    RowKernels::ThresholdRowFn threshold_row = RowKernels::threshold(_instructions);
+    cv::Mat1b strip;
+    while (_sink_ok && source(strip)) {
+      if (strip.cols != cols) {
+        printf("The strip has %i columns instead of %i\n", strip.cols, cols);
+        return false;
+      }
+      for (int strip_row = 0; strip_row < strip.rows && _sink_ok; ++strip_row) {
+        const uchar* strip_ptr = strip.ptr<uchar>(strip_row);
+        threshold_row(strip_ptr, ring_row(0, _nrows) + 1, cols,
+                      VoronoiThinner::THRESHOLD, true);
+        feed(0, _nrows);
+        ++_nrows;
+      } // end loop strip_row
+    } // end while (source(strip))
+
+    // the last row of each stage, the row below being zero
+    if (_nrows > 0) {
+      for (int stage = 0; stage < nstages() && _sink_ok; ++stage) {
+        const uchar* out = thin_row(stage, _nrows - 1, &(_zeros[0]));
+        if (stage + 1 == nstages())
+          emit_row(out);
+        else
+          feed(stage + 1, _nrows - 1);
+      } // end loop stage
+    }
+    if (_sink_ok && _nout_rows > 0) {
+      cv::Mat1b last_strip = _out_strip(cv::Rect(0, 0, cols, _nout_rows));
+      _sink_ok = sink_strip(last_strip);
+    }
+    return _sink_ok;
+  } // end thin()
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*!
+   * thin a binary PGM file (P5, 8 bits per pixel) into another one,
+   * without loading it: only the window of the pipeline
+   * and one strip of each file are in memory.
+   * While a pass has not converged, \a output_filename is thinned again
+   * by another pass, through the temporary file "<output_filename>.tmp":
+   * at the end, has_converged() is true and the skeleton is the one of
+   * VoronoiThinner::thin() without limit.
+   * \return false if a file can not be read or written, \see thin()
+   */
+  bool thin_pgm(const std::string & input_filename,
+                const std::string & output_filename) {
+    _npasses = 1;
+    if (!thin_pgm_pass(input_filename, output_filename))
+      return false;
+    // each pass that has not converged removed at least one pixel
+    std::string tmp_filename = output_filename + ".tmp";
+    while (!_has_converged) {
+      ++_npasses;
+      if (!thin_pgm_pass(output_filename, tmp_filename)) {
+        remove(tmp_filename.c_str());
+        return false;
+      }
+      if (rename(tmp_filename.c_str(), output_filename.c_str())) {
+        printf("Could not write file '%s'\n", output_filename.c_str());
+        return false;
+      }
+    } // end while (!_has_converged)
+    return true;
+  } // end thin_pgm()
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! read the header of a binary PGM file with 8 bits per pixel,
+   * \a in being then at the beginning of the pixels.
+   * \return false if it is not such a file
+   */
+  static bool read_pgm_header(std::istream & in, int & cols, int64_t & rows) {
+    std::string magic;
+    in >> magic;
+    int64_t values[3]; // cols, rows, maxval
+    for (int value_idx = 0; value_idx < 3; ++value_idx) {
+      in >> std::ws;
+      while (in.peek() == '#') { // comment
+        std::string comment;
+        std::getline(in, comment);
+        in >> std::ws;
+      }
+      in >> values[value_idx];
+    } // end loop value_idx
+    in.get(); // the whitespace before the pixels
+    if (!in.good() || magic != "P5" || values[0] <= 0 || values[0] > INT_MAX - 2
+        || values[1] < 0 || values[2] <= 0 || values[2] > 255)
+      return false;
+    cols = values[0];
+    rows = values[1];
+    return true;
+  }
+
+protected:
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! one pass of thin_pgm(): thin \a input_filename into \a output_filename
+   * with max_iters iterations, \see thin()
+   */
+  bool thin_pgm_pass(const std::string & input_filename,
+                     const std::string & output_filename) {
+    std::ifstream in(input_filename.c_str(), std::ios::binary);
+    int cols;
+    int64_t rows;
+    if (!in.is_open() || !read_pgm_header(in, cols, rows)) {
+      printf("Could not read the binary PGM file '%s'\n", input_filename.c_str());
+      return false;
+    }
+    std::ofstream out(output_filename.c_str(), std::ios::binary);
+    out << "P5\n" << cols << " " << rows << "\n255\n";
+    if (!out.good()) {
+      printf("Could not write file '%s'\n", output_filename.c_str());
+      return false;
+    }
+    int64_t nread = 0;
+    bool read_ok = true;
+    bool ok = thin(cols, [&](cv::Mat1b & strip) {
+      if (nread >= rows)
+        return false;
+      int nrows = std::min((int64_t) _strip_rows, rows - nread);
+      fit_workspace(strip, _in_buffer, nrows, cols);
+      in.read((char*) strip.data, (std::streamsize) nrows * cols);
+      if (!in.good()) {
+        printf("File '%s' is truncated after row %li\n",
+               input_filename.c_str(), (long) nread);
+        read_ok = false;
+        return false;
+      }
+      nread += nrows;
+      return true;
+    }, [&](int64_t /*first_row*/, const cv::Mat1b & strip) {
+      for (int row = 0; row < strip.rows; ++row)
+        out.write((const char*) strip.ptr<uchar>(row), cols);
+      return out.good();
+    });
+    out.close();
+    if (ok && out.fail())
+      printf("Could not write file '%s'\n", output_filename.c_str());
+    return (ok && read_ok && !out.fail());
+  } // end thin_pgm_pass()
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! \return the number of sub-iterations, one per stage
+  inline int nstages() const { return 2 * (_max_iters + 1); }
+
+  //! \return the row \a row of the input of stage \a stage
+  inline uchar* ring_row(int stage, int64_t row) {
+    return &(_rings[((size_t) stage * 3 + row % 3) * _width]);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! thin the row \a row of the input of \a stage, the row below being \a down.
+   * \return the thinned row, the input of the next stage
+   *   or _out_row for the last one */
+  inline const uchar* thin_row(int stage, int64_t row, const uchar* down) {
+    const uchar* up = (row > 0 ? ring_row(stage, row - 1) : &(_zeros[0]));
+    const uchar* mid = ring_row(stage, row);
+    uchar* out = (stage + 1 < nstages() ? ring_row(stage + 1, row) : &(_out_row[0]));
+    memcpy(out, mid, _width);
+    int iter = stage % 2;
+    if (_row_fn(up, mid, down, out, _width, iter, _tables[iter])
+        && stage >= nstages() - 2) // last iteration
+      _has_converged = false;
+    return out;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  /*! the row \a row was added to the input of \a stage:
+   * thin the row above it, then the ones it makes ready in the next stages */
+  inline void feed(int stage, int64_t row) {
+    for (; row >= 1 && _sink_ok; ++stage, --row) {
+      const uchar* out = thin_row(stage, row - 1, ring_row(stage, row));
+      if (stage + 1 == nstages()) {
+        emit_row(out);
+        return;
+      }
+    } // end loop stage
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  //! add a row of the last stage to the output strip
+  inline void emit_row(const uchar* out) {
+    uchar* strip_ptr = _out_strip.ptr<uchar>(_nout_rows);
+    for (int col = 0; col < _cols; ++col)
+      strip_ptr[col] = (out[col + 1] ? 255 : 0);
+    if (++_nout_rows == _strip_rows)
+      _sink_ok = sink_strip(_out_strip);
+  }
+
+  //! give \a strip to the sink
+  inline bool sink_strip(const cv::Mat1b & strip) {
+    bool ok = _sink(_nout_first_row, strip);
+    _nout_first_row += strip.rows;
+    _nout_rows = 0;
+    return ok;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+
+  std::string _implementation_name;
+  int _implementation;
+  int _max_iters, _strip_rows;
+  RowKernels::Instructions _instructions;
+  RowKernels::RowFn _row_fn;
+  const uchar* _tables[2];
+  bool _has_converged;
+  //! the number of rows read
+  int64_t _nrows;
+  //! the number of passes of thin_pgm()
+  int _npasses;
+  int _cols, _width;
+  //! the last three input rows of each stage
+  std::vector<uchar> _rings;
+  std::vector<uchar> _zeros, _out_row;
+  //! the strip being filled for the sink
+  cv::Mat1b _out_strip;
+  int _nout_rows;
+  int64_t _nout_first_row;
+  Sink _sink;
+  bool _sink_ok;
+  //! the memory of the strips read from files
+  std::vector<uchar> _in_buffer;
+}; // end class VoronoiStripThinner
+
+#endif // VORONOI_STRIP_H
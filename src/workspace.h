@@ -0,0 +1,65 @@
+/*!
+  \file        workspace.h
+  \author      Arnaud Ramey <arnaud.a.ramey@gmail.com>
+                -- Robotics Lab, University Carlos III of Madrid
+  \date        2026/10/18
+
+________________________________________________________________________________
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+________________________________________________________________________________
+
+Working images whose memory only grows.
+
+cv::Mat::create() allocates a new buffer each time the size changes,
+which happens on almost every call when the images are cropped
+to their bounding box.
+A workspace is a cv::Mat1b header on the memory of a std::vector:
+once the vector reached the largest size, resizing does not allocate anymore.
+
+ */
+
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+/*!
+ * make \a mat a continuous image of \a rows x \a cols
+ * on the memory of \a buffer, that is grown if needed.
+ * The content of \a mat is undefined.
+ * The images that used the memory of \a buffer are invalidated if it grows.
+ */
+inline void fit_workspace(cv::Mat1b & mat, std::vector<uchar> & buffer,
+                          int rows, int cols) {
+  size_t npixels = (size_t) rows * cols;
+  if (!npixels) {
+    mat = cv::Mat1b(rows, cols);
+    return;
+  }
+  if (buffer.size() < npixels)
+    buffer.resize(npixels);
+  if (mat.data == &(buffer[0]) && mat.rows == rows && mat.cols == cols)
+    return;
+  mat = cv::Mat1b(rows, cols, &(buffer[0]));
+}
+
+//! fit_workspace() with a cv::Size
+inline void fit_workspace(cv::Mat1b & mat, std::vector<uchar> & buffer,
+                          const cv::Size & size) {
+  fit_workspace(mat, buffer, size.height, size.width);
+}
+
+#endif // WORKSPACE_H